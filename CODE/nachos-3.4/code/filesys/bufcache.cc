@@ -0,0 +1,455 @@
+// bufcache.cc 
+//	Routines to manage the disk sector cache.
+//
+//	Disk I/O is done with the cache's lock released, so one thread's
+//	miss does not hold up other threads' hits.  While its I/O is in
+//	progress an entry is marked busy: it is neither handed out nor
+//	evicted, and threads that want it wait on "ioDone".
+//
+//	Syncing and prefetching queue all their requests with the disk at
+//	once, and then wait for the whole batch, so the disk scheduler can
+//	order them to suit the head.  Runs of consecutive sectors, when
+//	syncing or when a caller reads several at once, go to the disk as
+//	a single request.
+//
+//	If the file system has a journal, sectors written by the thread
+//	making an update are logged to it as well, and no sector goes
+//	back to disk before the journal says it may.
+//
+// Copyright (c) 1992-1993 The Regents of the University of California.
+// All rights reserved.  See copyright.h for copyright notice and limitation 
+// of liability and disclaimer of warranty provisions.
+
+#include "copyright.h"
+#include "bufcache.h"
+#include "system.h"
+
+//----------------------------------------------------------------------
+// BufferCache::BufferCache
+// 	Initialize an empty cache.
+//
+//	"cacheDisk" -- the disk whose sectors we cache
+//	"cacheSize" -- how many sectors to keep in memory
+//----------------------------------------------------------------------
+
+BufferCache::BufferCache(Volume *cacheDisk, int cacheSize) {
+    int i;
+
+    ASSERT(cacheSize > 0);
+    disk = cacheDisk;
+    numEntries = cacheSize;
+    numSectors = disk->Size();
+    journal = NULL;
+    entries = new CacheEntry[numEntries];
+    lookup = new CacheEntry *[numSectors];
+    for (i = 0; i < numSectors; i++)
+        lookup[i] = NULL;
+
+    head = tail = NULL;
+    for (i = 0; i < numEntries; i++) {
+        entries[i].sector = -1;
+        entries[i].dirty = FALSE;
+        entries[i].busy = FALSE;
+        entries[i].prev = entries[i].next = NULL;
+        Touch(&entries[i]);
+    }
+    lock = new Lock("buffer cache");
+    ioDone = new Condition("buffer cache I/O done");
+
+    reader = NULL;
+    pending = new int[numEntries];
+    pendingHead = numPending = 0;
+    prefetchWanted = new Condition("buffer cache prefetch");
+}
+
+//----------------------------------------------------------------------
+// BufferCache::~BufferCache
+// 	Throw the cache away.  It must have been synced already: this
+//	runs as Nachos halts, when no thread is left to wait for the disk.
+//----------------------------------------------------------------------
+
+BufferCache::~BufferCache() {
+    for (int i = 0; i < numEntries; i++)
+        ASSERT(!entries[i].dirty && !entries[i].busy);
+    delete prefetchWanted;
+    delete[] pending;
+    delete ioDone;
+    delete lock;
+    delete[] lookup;
+    delete[] entries;
+}
+
+//----------------------------------------------------------------------
+// BufferCache::ReadSector
+// 	Copy the contents of a sector into "data", reading it from disk
+//	only if it isn't cached.
+//----------------------------------------------------------------------
+
+void
+BufferCache::ReadSector(int sectorNumber, char *data) {
+    CacheEntry *entry;
+
+    lock->Acquire();
+    entry = Get(sectorNumber, TRUE);
+    bcopy(entry->data, data, SectorSize);
+    lock->Release();
+}
+
+//----------------------------------------------------------------------
+// BufferCache::WriteSector
+// 	Replace the contents of a sector.  Only the cached copy changes;
+//	the disk is updated when the sector is evicted or synced.  Since
+//	the whole sector is overwritten, a miss doesn't read the disk.
+//----------------------------------------------------------------------
+
+void
+BufferCache::WriteSector(int sectorNumber, char *data) {
+    CacheEntry *entry;
+
+    lock->Acquire();
+    entry = Get(sectorNumber, FALSE);
+    bcopy(data, entry->data, SectorSize);
+    entry->dirty = TRUE;
+    if (journal != NULL && journal->Logging())
+        journal->Log(sectorNumber, data);
+    lock->Release();
+}
+
+//----------------------------------------------------------------------
+// BufferCache::ReadSectors
+// 	Copy the contents of "count" consecutive sectors into "data".
+//	Cached sectors are copied from the cache; each run of uncached
+//	ones is read from disk with a single request, straight into
+//	"data", and then cached.
+//
+//	A run is cut short rather than wait for an entry to come free,
+//	since we already hold the entries claimed for it.
+//----------------------------------------------------------------------
+
+void
+BufferCache::ReadSectors(int sectorNumber, char *data, int count) {
+    int maxRun = max(1, numEntries / 2);
+    CacheEntry **run = new CacheEntry *[maxRun];
+    CacheEntry *entry;
+    int i, j, n;
+
+    lock->Acquire();
+    for (i = 0; i < count; i += n) {
+        for (n = 0; i + n < count && n < maxRun; n++) {
+            entry = Claim(sectorNumber + i + n, n == 0);
+            if (entry == NULL)
+                break;
+            run[n] = entry;
+        }
+        if (n == 0) {                   // cached
+            entry = Get(sectorNumber + i, TRUE);
+            bcopy(entry->data, &data[i * SectorSize], SectorSize);
+            n = 1;
+            continue;
+        }
+        lock->Release();
+        disk->ReadSectors(sectorNumber + i, &data[i * SectorSize], n);
+        lock->Acquire();
+        for (j = 0; j < n; j++) {
+            bcopy(&data[(i + j) * SectorSize], run[j]->data, SectorSize);
+            run[j]->busy = FALSE;
+        }
+        ioDone->Broadcast(lock);
+    }
+    lock->Release();
+    delete[] run;
+}
+
+//----------------------------------------------------------------------
+// BufferCache::WriteSectors
+// 	Replace the contents of "count" consecutive sectors.  As with
+//	WriteSector, only the cache changes; Sync writes them back as one
+//	run.
+//----------------------------------------------------------------------
+
+void
+BufferCache::WriteSectors(int sectorNumber, char *data, int count) {
+    CacheEntry *entry;
+
+    lock->Acquire();
+    for (int i = 0; i < count; i++) {
+        entry = Get(sectorNumber + i, FALSE);
+        bcopy(&data[i * SectorSize], entry->data, SectorSize);
+        entry->dirty = TRUE;
+        if (journal != NULL && journal->Logging())
+            journal->Log(sectorNumber + i, &data[i * SectorSize]);
+    }
+    lock->Release();
+}
+
+//----------------------------------------------------------------------
+// BufferCache::Sync
+// 	Write every dirty sector back to disk, as one batch of requests.
+//	Dirty sectors are visited in disk order, and each run of
+//	consecutive ones is written with a single request.  Then sync the
+//	disk itself, so it all survives Nachos exiting.  Sectors pinned
+//	by an update still in progress stay dirty.
+//----------------------------------------------------------------------
+
+void
+BufferCache::Sync() {
+    VolumeRequest **requests = new VolumeRequest *[numEntries];
+    char **buffers = new char *[numEntries];
+    CacheEntry **batch = new CacheEntry *[numEntries];
+    CacheEntry *entry;
+    int i, n, sector, count = 0, numRuns = 0;
+
+    lock->Acquire();
+    for (i = 0; i < numEntries; i++)    // let writes in progress finish
+        while (entries[i].busy)
+            ioDone->Wait(lock);
+    for (sector = 0; sector < numSectors; sector += n + 1) {
+        for (n = 0; sector + n < numSectors; n++) {
+            entry = lookup[sector + n];
+            if (entry == NULL || !entry->dirty || Pinned(entry))
+                break;
+            entry->busy = TRUE;         // no one touches it until we're done
+            entry->dirty = FALSE;
+            if (journal != NULL)
+                journal->WritingHome(sector + n);
+            batch[count++] = entry;
+        }
+        if (n == 0)
+            continue;
+        buffers[numRuns] = new char[n * SectorSize];
+        for (i = 0; i < n; i++)
+            bcopy(batch[count - n + i]->data,
+                  &buffers[numRuns][i * SectorSize], SectorSize);
+        requests[numRuns] = disk->WriteAsync(sector, buffers[numRuns], n);
+        numRuns++;
+    }
+    lock->Release();
+    disk->WaitAll(requests, numRuns);
+    lock->Acquire();
+    for (i = 0; i < count; i++)
+        batch[i]->busy = FALSE;
+    ioDone->Broadcast(lock);
+    lock->Release();
+    disk->Sync();
+    for (i = 0; i < numRuns; i++)
+        delete[] buffers[i];
+    delete[] requests;
+    delete[] buffers;
+    delete[] batch;
+}
+
+//----------------------------------------------------------------------
+// ReadAheadThread
+// 	Entry point of the prefetching thread.  Need this to be a C
+//	routine, because C++ can't handle pointers to member functions.
+//----------------------------------------------------------------------
+
+static void
+ReadAheadThread(_int arg) {
+    BufferCache *cache = (BufferCache *) arg;
+
+    cache->ReadAhead();
+}
+
+//----------------------------------------------------------------------
+// BufferCache::Prefetch
+// 	Queue "sectorNumber" to be read into the cache in the background,
+//	and return right away.  Nothing happens if the sector is already
+//	cached, or if so much is already queued that reading more would
+//	just evict what was prefetched before it can be used.
+//----------------------------------------------------------------------
+
+void
+BufferCache::Prefetch(int sectorNumber) {
+    ASSERT((sectorNumber >= 0) && (sectorNumber < numSectors));
+    lock->Acquire();
+    if (lookup[sectorNumber] == NULL && numPending < numEntries / 2) {
+        pending[(pendingHead + numPending++) % numEntries] = sectorNumber;
+        if (reader == NULL) {
+            reader = new Thread("read ahead");
+            reader->Fork(ReadAheadThread, (_int) this);
+        }
+        prefetchWanted->Signal(lock);
+    }
+    lock->Release();
+}
+
+//----------------------------------------------------------------------
+// BufferCache::ReadAhead
+// 	Loop forever, reading queued sectors into the cache.  Everything
+//	queued so far is read as one batch.  A sector that got cached
+//	since it was queued costs nothing.
+//----------------------------------------------------------------------
+
+void
+BufferCache::ReadAhead() {
+    VolumeRequest **requests = new VolumeRequest *[numEntries];
+    CacheEntry **batch = new CacheEntry *[numEntries];
+    CacheEntry *entry;
+    int i, count, sectorNumber;
+
+    lock->Acquire();
+    for (;;) {
+        while (numPending == 0)
+            prefetchWanted->Wait(lock);
+        for (count = 0; numPending > 0; ) {
+            sectorNumber = pending[pendingHead];
+            pendingHead = (pendingHead + 1) % numEntries;
+            numPending--;               // now, as Claim may drop the lock
+            entry = Claim(sectorNumber, count == 0);
+            if (entry == NULL)          // cached already, or no room
+                continue;
+            stats->numReadAheads++;
+            batch[count] = entry;
+            requests[count++] = disk->ReadAsync(sectorNumber, entry->data);
+        }
+        lock->Release();
+        disk->WaitAll(requests, count);
+        lock->Acquire();
+        for (i = 0; i < count; i++)
+            batch[i]->busy = FALSE;
+        ioDone->Broadcast(lock);
+    }
+}
+
+//----------------------------------------------------------------------
+// BufferCache::Get
+// 	Return the entry caching "sectorNumber", most recently used and
+//	not busy.  On a miss, claim an entry for it, and if "fetch" is
+//	set, read the sector into it.  Called, and returns, with the lock
+//	held.
+//----------------------------------------------------------------------
+
+CacheEntry *
+BufferCache::Get(int sectorNumber, bool fetch) {
+    CacheEntry *entry;
+
+    ASSERT((sectorNumber >= 0) && (sectorNumber < numSectors));
+    for (;;) {
+        entry = lookup[sectorNumber];
+        if (entry != NULL) {
+            if (entry->busy) {            // someone else is reading it
+                ioDone->Wait(lock);
+                continue;
+            }
+            stats->numCacheHits++;
+            Touch(entry);
+            return entry;
+        }
+        entry = Claim(sectorNumber, TRUE);
+        if (entry != NULL)
+            break;
+    }
+
+    if (fetch) {
+        lock->Release();
+        disk->ReadSector(sectorNumber, entry->data);
+        lock->Acquire();
+    }
+    entry->busy = FALSE;
+    ioDone->Broadcast(lock);
+    return entry;
+}
+
+//----------------------------------------------------------------------
+// BufferCache::Claim
+// 	Evict the least recently used idle entry (writing it back first,
+//	if it is dirty), and hand it over to "sectorNumber", marked busy;
+//	the caller fills it in and clears "busy".  Returns NULL if the
+//	sector turns out to be cached after all -- or, unless "mayWait"
+//	is set, if every entry is busy.  Called, and returns, with the
+//	lock held.
+//
+//	Entries the journal has pinned are passed over; only if nothing
+//	else is idle does one go, committing part of an update.
+//----------------------------------------------------------------------
+
+CacheEntry *
+BufferCache::Claim(int sectorNumber, bool mayWait) {
+    CacheEntry *entry;
+
+    ASSERT((sectorNumber >= 0) && (sectorNumber < numSectors));
+    for (;;) {
+        if (lookup[sectorNumber] != NULL)
+            return NULL;
+        for (entry = tail; entry != NULL; entry = entry->prev)
+            if (!entry->busy && !Pinned(entry))
+                break;
+        if (entry == NULL)                // a tiny cache: take what's idle
+            for (entry = tail; entry != NULL && entry->busy;
+                 entry = entry->prev)
+                ;
+        if (entry == NULL) {              // everything is busy
+            if (!mayWait)
+                return NULL;
+            ioDone->Wait(lock);
+            continue;
+        }
+        if (entry->dirty) {               // clean it, then look again:
+            WriteOut(entry);              // things may have changed
+            continue;
+        }
+        break;
+    }
+
+    stats->numCacheMisses++;
+    if (entry->sector != -1)
+        lookup[entry->sector] = NULL;
+    entry->sector = sectorNumber;
+    lookup[sectorNumber] = entry;
+    entry->busy = TRUE;
+    Touch(entry);
+    return entry;
+}
+
+//----------------------------------------------------------------------
+// BufferCache::WriteOut
+// 	Write a dirty entry back to disk.  Called, and returns, with the
+//	lock held, but the lock is dropped during the write.
+//----------------------------------------------------------------------
+
+void
+BufferCache::WriteOut(CacheEntry *entry) {
+    entry->busy = TRUE;             // no one touches it until we're done
+    entry->dirty = FALSE;
+    if (journal != NULL)
+        journal->WritingHome(entry->sector);
+    lock->Release();
+    disk->WriteSector(entry->sector, entry->data);
+    lock->Acquire();
+    entry->busy = FALSE;
+    ioDone->Broadcast(lock);
+}
+
+//----------------------------------------------------------------------
+// BufferCache::Touch/Unlink
+// 	Maintain the LRU list: Touch makes "entry" the most recently used,
+//	Unlink takes it off the list.
+//----------------------------------------------------------------------
+
+void
+BufferCache::Touch(CacheEntry *entry) {
+    if (head == entry)
+        return;
+    Unlink(entry);
+    entry->prev = NULL;
+    entry->next = head;
+    if (head != NULL)
+        head->prev = entry;
+    head = entry;
+    if (tail == NULL)
+        tail = entry;
+}
+
+void
+BufferCache::Unlink(CacheEntry *entry) {
+    if (entry->prev != NULL)
+        entry->prev->next = entry->next;
+    else if (head == entry)
+        head = entry->next;
+    if (entry->next != NULL)
+        entry->next->prev = entry->prev;
+    else if (tail == entry)
+        tail = entry->prev;
+    entry->prev = entry->next = NULL;
+}
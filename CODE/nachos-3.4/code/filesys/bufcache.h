@@ -0,0 +1,104 @@
+// bufcache.h 
+//	Data structures for a cache of disk sectors, sitting between the
+//	file system and the synchronous disk.
+//
+//	The file system re-reads the same sectors over and over -- the
+//	bitmap, the directory, file headers -- and each read costs a seek
+//	and a rotation on the simulated disk.  The cache keeps the most
+//	recently used sectors in memory.  Writes only mark the cached copy
+//	dirty; a dirty sector goes to disk when it is evicted, or when the
+//	cache is synced (at the latest, when Nachos shuts down).
+//
+//	Sectors can also be prefetched: a background thread reads them
+//	into the cache, so a later ReadSector finds them there.
+//
+// Copyright (c) 1992-1993 The Regents of the University of California.
+// All rights reserved.  See copyright.h for copyright notice and limitation 
+// of liability and disclaimer of warranty provisions.
+
+#include "copyright.h"
+
+#ifndef BUFCACHE_H
+#define BUFCACHE_H
+
+#include "disk.h"
+#include "synch.h"
+#include "volume.h"
+#include "journal.h"
+
+#define DefaultCacheSize	64	// sectors cached, unless "-bc" says
+
+// One cached sector.  Entries are kept on a list in least recently used
+// order, so the one to evict is always at the tail.
+
+class CacheEntry {
+  public:
+    int sector;				// sector cached here, -1 if none
+    bool dirty;				// modified since read from disk?
+    bool busy;				// being read or written right now?
+    CacheEntry *prev, *next;		// neighbours in LRU order
+    char data[SectorSize];		// the contents of the sector
+};
+
+// The following class defines the cache.  It has the same interface as
+// SynchDisk (and Volume), so the file system can use either one.
+
+class BufferCache {
+  public:
+    BufferCache(Volume *cacheDisk, int cacheSize);
+					// Cache up to "cacheSize" sectors
+					// of "cacheDisk"
+    ~BufferCache();			// Nothing may be dirty: Sync first
+
+    void ReadSector(int sectorNumber, char *data);
+    void WriteSector(int sectorNumber, char *data);
+					// Read/write a sector, through the
+					// cache
+    void ReadSectors(int sectorNumber, char *data, int count);
+    void WriteSectors(int sectorNumber, char *data, int count);
+					// Read/write "count" consecutive
+					// sectors; uncached runs are read
+					// with one disk request
+
+    void Sync();			// Write every dirty sector to disk,
+					// and sync the disk
+
+    void SetJournal(Journal *log) { journal = log; }
+    					// Log sectors written while the
+					// journal has an update in progress
+
+    void Prefetch(int sectorNumber);	// Start reading a sector into the
+					// cache in the background
+    void ReadAhead();			// Body of the prefetching thread
+
+  private:
+    CacheEntry *Get(int sectorNumber, bool fetch);
+					// Find or make room for a sector
+    CacheEntry *Claim(int sectorNumber, bool mayWait);
+					// Make room for an uncached sector
+    void Touch(CacheEntry *entry);	// Move "entry" to the front of the
+					// LRU list
+    void Unlink(CacheEntry *entry);	// Take "entry" off the LRU list
+    void WriteOut(CacheEntry *entry);	// Write "entry" back to disk
+    bool Pinned(CacheEntry *entry)	// Must "entry" stay dirty for now?
+	{ return entry->dirty && journal != NULL
+		 && journal->Pinned(entry->sector); }
+
+    Volume *disk;			// where the data really lives
+    int numSectors;			// how many sectors it has
+    Journal *journal;			// where metadata is logged, or NULL
+    int numEntries;			// size of the cache
+    CacheEntry *entries;		// the cache itself
+    CacheEntry **lookup;		// entry holding each sector, or NULL
+    CacheEntry *head, *tail;		// most/least recently used entry
+    Lock *lock;				// protects all of the above
+    Condition *ioDone;			// signalled whenever an entry stops
+					// being busy
+
+    Thread *reader;			// the prefetching thread, if started
+    int *pending;			// sectors waiting to be prefetched,
+    int pendingHead, numPending;	// a ring of "numEntries" slots
+    Condition *prefetchWanted;		// signalled when "pending" grows
+};
+
+#endif // BUFCACHE_H
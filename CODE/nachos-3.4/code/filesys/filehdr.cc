@@ -3,12 +3,14 @@
 //	would be called the i-node).
 //
 //	The file header is used to locate where on disk the 
-//	file's data is stored.  We implement this as a fixed size
-//	table of pointers -- each entry in the table points to the 
-//	disk sector containing that portion of the file data
-//	(in other words, there are no indirect or doubly indirect 
-//	blocks). The table size is chosen so that the file header
-//	will be just big enough to fit in one disk sector, 
+//	file's data is stored.  We implement this as a table of
+//	extents -- each entry in the table is a run of consecutive
+//	disk sectors holding the next part of the file data
+//	(there are no indirect or doubly indirect blocks).  The
+//	table size is chosen so that the file header will be just
+//	big enough to fit in one disk sector.  A file grows with
+//	Extend, which lengthens its last extent where the sectors
+//	after it are free, and starts a new one otherwise.
 //
 //      Unlike in a real system, we do not keep track of file permissions, 
 //	ownership, last modification date, etc., in the file header. 
@@ -27,6 +29,77 @@
 #include "system.h"
 #include "filehdr.h"
 
+//----------------------------------------------------------------------
+// FileHeader::AllocateSectors
+// 	Add "count" sectors to the end of the file.  Grow the last extent
+//	in place if the sectors after it are free; otherwise take a free
+//	run of the size still needed, or failing that, of half the size,
+//	and so on.  Return FALSE, having allocated nothing,
+//	if the disk is too full or too fragmented.
+//
+//	A new run is looked for from the end of the file's last run (or
+//	from "goal", for the first), and one that fits within a track is
+//	preferred: the disk reads the whole track into its track buffer,
+//	so reading the file through then costs one seek and rotation per
+//	track rather than per sector.
+//
+//	"freeMap" is the bit map of free disk sectors
+//	"goal" is where to start looking for the first run, or -1
+//----------------------------------------------------------------------
+
+bool
+FileHeader::AllocateSectors(BitMap *freeMap, int count, int goal) {
+    int oldSectors = numSectors, oldExtents = numExtents;
+    int oldLength = (numExtents > 0) ? extents[numExtents - 1].length : 0;
+    Extent *last;
+    int start, length;
+
+    if (freeMap->NumClear() < count)
+        return FALSE;        // not enough space
+
+    while (count > 0) {
+        last = (numExtents > 0) ? &extents[numExtents - 1] : NULL;
+        if (last != NULL && last->start + last->length < freeMap->NumBits()
+            && !freeMap->Test(last->start + last->length)) {
+            freeMap->Mark(last->start + last->length);
+            last->length++;         // just keep going
+            numSectors++;
+            count--;
+            continue;
+        }
+        if (numExtents == NumExtents)
+            break;                  // too fragmented
+        if (last != NULL)
+            goal = last->start + last->length;
+        // the whole rest in one run if possible, else ever smaller runs
+        for (length = count;
+             (start = freeMap->FindRun(length, goal, SectorsPerTrack)) == -1;)
+            length /= 2;
+        ASSERT(length > 0);
+        extents[numExtents].start = start;
+        extents[numExtents].length = length;
+        numExtents++;
+        numSectors += length;
+        count -= length;
+    }
+    if (count == 0)
+        return TRUE;
+
+    // out of extents: give back what we took
+    for (int e = oldExtents - 1; e < numExtents; e++) {
+        if (e < 0)
+            continue;
+        int from = (e == oldExtents - 1) ? oldLength : 0;
+        for (int i = from; i < extents[e].length; i++)
+            freeMap->Clear(extents[e].start + i);
+    }
+    if (oldExtents > 0)
+        extents[oldExtents - 1].length = oldLength;
+    numExtents = oldExtents;
+    numSectors = oldSectors;
+    return FALSE;
+}
+
 //----------------------------------------------------------------------
 // FileHeader::Allocate
 // 	Initialize a fresh file header for a newly created file.
@@ -36,18 +109,15 @@
 //
 //	"freeMap" is the bit map of free disk sectors
 //	"fileSize" is the bit map of free disk sectors
+//	"goal" is where the data should preferably start, or -1
 //----------------------------------------------------------------------
 
 bool
-FileHeader::Allocate(BitMap *freeMap, int fileSize) {
+FileHeader::Allocate(BitMap *freeMap, int fileSize, int goal) {
     numBytes = fileSize;
-    numSectors = divRoundUp(fileSize, SectorSize);
-    if (freeMap->NumClear() < numSectors)
-        return FALSE;        // not enough space
-
-    for (int i = 0; i < numSectors; i++)
-        dataSectors[i] = freeMap->Find();
-    return TRUE;
+    numSectors = 0;
+    numExtents = 0;
+    return AllocateSectors(freeMap, divRoundUp(fileSize, SectorSize), goal);
 }
 
 //----------------------------------------------------------------------
@@ -59,22 +129,28 @@ FileHeader::Allocate(BitMap *freeMap, int fileSize) {
 
 void
 FileHeader::Deallocate(BitMap *freeMap) {
-    for (int i = 0; i < numSectors; i++) {
-        ASSERT(freeMap->Test((int) dataSectors[i]));  // ought to be marked!
-        freeMap->Clear((int) dataSectors[i]);
+    for (int e = 0; e < numExtents; e++) {
+        for (int i = 0; i < extents[e].length; i++) {
+            ASSERT(freeMap->Test(extents[e].start + i));  // ought to be marked!
+            freeMap->Clear(extents[e].start + i);
+        }
     }
 }
 
 //----------------------------------------------------------------------
 // FileHeader::FetchFrom
-// 	Fetch contents of file header from disk. 
+// 	Fetch contents of file header from disk.  The header doesn't fill
+//	the whole sector, so it goes through a sector sized buffer.
 //
 //	"sector" is the disk sector containing the file header
 //----------------------------------------------------------------------
 
 void
 FileHeader::FetchFrom(int sector) {
-    synchDisk->ReadSector(sector, (char *) this);
+    char buf[SectorSize];
+
+    bufferCache->ReadSector(sector, buf);
+    bcopy(buf, (char *) this, sizeof(FileHeader));
 }
 
 //----------------------------------------------------------------------
@@ -86,7 +162,11 @@ FileHeader::FetchFrom(int sector) {
 
 void
 FileHeader::WriteBack(int sector) {
-    synchDisk->WriteSector(sector, (char *) this);
+    char buf[SectorSize];
+
+    bzero(buf, SectorSize);
+    bcopy((char *) this, buf, sizeof(FileHeader));
+    bufferCache->WriteSector(sector, buf);
 }
 
 //----------------------------------------------------------------------
@@ -101,7 +181,12 @@ FileHeader::WriteBack(int sector) {
 
 int
 FileHeader::ByteToSector(int offset) {
-    return (dataSectors[offset / SectorSize]);
+    int index = offset / SectorSize;
+    int e;
+
+    for (e = 0; index >= extents[e].length; e++)
+        index -= extents[e].length;
+    return extents[e].start + index;
 }
 
 //----------------------------------------------------------------------
@@ -122,15 +207,16 @@ FileHeader::FileLength() {
 
 void
 FileHeader::Print() {
-    int i, j, k;
+    int e, i, j, k;
     char *data = new char[SectorSize];
 
     printf("FileHeader contents.  File size: %d.  File blocks:\n", numBytes);
-    for (i = 0; i < numSectors; i++)
-        printf("%d ", dataSectors[i]);
+    for (e = 0; e < numExtents; e++)
+        printf("%d-%d ", extents[e].start,
+               extents[e].start + extents[e].length - 1);
     printf("\nFile contents:\n");
     for (i = k = 0; i < numSectors; i++) {
-        synchDisk->ReadSector(dataSectors[i], data);
+        bufferCache->ReadSector(ByteToSector(i * SectorSize), data);
         for (j = 0; (j < SectorSize) && (k < numBytes); j++, k++) {
             if ('\040' <= data[j] && data[j] <= '\176')   // isprint(data[j])
                 printf("%c", data[j]);
@@ -142,7 +228,16 @@ FileHeader::Print() {
     delete[] data;
 }
 
-int FileHeader::Extend(int newFileSize) {
+//----------------------------------------------------------------------
+// FileHeader::Extend
+// 	Grow the file to "newFileSize" bytes.  Returns 0 if nothing changed,
+//	1 if only the length changed, 2 if sectors were taken from
+//	"freeMap", and -1 if there was no room for the new sectors.
+//
+//	"freeMap" is the file system's in-memory bit map of free sectors
+//----------------------------------------------------------------------
+
+int FileHeader::Extend(BitMap *freeMap, int newFileSize) {
     // nothing needs to change
     if (newFileSize <= numBytes) {
         return 0;
@@ -157,20 +252,10 @@ int FileHeader::Extend(int newFileSize) {
 
     // change fileSize and numSectors
     int appendSectorsNum = newNumSectors - numSectors;
-    // bitmap is located in 0 sector
-    OpenFile *bitmapFile = new OpenFile(0);
-    BitMap *freeMap = new BitMap(NumSectors);
-    freeMap->FetchFrom(bitmapFile);
     // similar to Allocate() function
     // if no more space to allocate new sectors, just return -1
-    if (newNumSectors > NumDirect || freeMap->NumClear() < appendSectorsNum) {
+    if (!AllocateSectors(freeMap, appendSectorsNum, -1))
         return -1;
-    }
-    for (int i = numSectors; i < newNumSectors; i++) {
-        dataSectors[i] = freeMap->Find();
-    }
-    freeMap->WriteBack(bitmapFile);
     numBytes = newFileSize;
-    numSectors = newNumSectors;
     return 2;
 }
@@ -17,19 +17,30 @@
 #include "disk.h"
 #include "bitmap.h"
 
-#define NumDirect    ((SectorSize - 2 * sizeof(int)) / sizeof(int))
-#define MaxFileSize    (NumDirect * SectorSize)
+#define NumExtents    ((SectorSize - 3 * sizeof(int)) / sizeof(Extent))
+#define MaxFileSize    (NumSectors * SectorSize)
+
+// A run of consecutive disk sectors holding consecutive data of a file.
+
+class Extent {
+public:
+    int start;            // first sector of the run
+    int length;            // number of sectors in the run
+};
 
 // The following class defines the Nachos "file header" (in UNIX terms,  
 // the "i-node"), describing where on disk to find all of the data in the file.
-// The file header is organized as a simple table of pointers to
-// data blocks. 
+// The file header is organized as a short table of extents: the file's
+// data blocks, in order, are the sectors of the first extent, then
+// those of the second, and so on.  Space is allocated in contiguous
+// runs wherever possible, so a file usually has only a few extents, and
+// reading it through sequentially doesn't seek between its sectors.
 //
 // The file header data structure can be stored in memory or on disk.
 // When it is on disk, it is stored in a single sector -- this means
 // that we assume the size of this data structure to be the same
-// as one disk sector.  Without indirect addressing, this
-// limits the maximum file length to just under 4K bytes.
+// as one disk sector.  A file can be as big as the disk, as long as
+// its free space isn't fragmented into more than NumExtents runs.
 //
 // There is no constructor; rather the file header can be initialized
 // by allocating blocks for the file (if it is a new file), or by
@@ -37,9 +48,11 @@
 
 class FileHeader {
 public:
-    bool Allocate(BitMap *bitMap, int fileSize);// Initialize a file header, 
+    bool Allocate(BitMap *bitMap, int fileSize, int goal = -1);
+    // Initialize a file header,
     //  including allocating space
-    //  on disk for the file data
+    //  on disk for the file data,
+    //  starting near "goal" if given
     void Deallocate(BitMap *bitMap);        // De-allocate this file's
     //  data blocks
 
@@ -56,13 +69,19 @@ public:
 
     void Print();            // Print the contents of the file.
 
-    int Extend(int newFileSize);
+    int Extend(BitMap *freeMap, int newFileSize);
+    // Grow the file to "newFileSize" bytes,
+    // taking sectors from "freeMap"
 
 private:
+    bool AllocateSectors(BitMap *freeMap, int count, int goal);
+    // Add "count" sectors to the end of
+    // the file, in as few runs as we can
+
     int numBytes;            // Number of bytes in the file
     int numSectors;            // Number of data sectors in the file
-    int dataSectors[NumDirect];        // Disk sector numbers for each data
-    // block in the file
+    int numExtents;            // Number of entries of "extents" in use
+    Extent extents[NumExtents];        // Where the data blocks are, in order
 };
 
 #endif // FILEHDR_H
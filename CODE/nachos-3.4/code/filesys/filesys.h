@@ -65,6 +65,26 @@ bool Remove(char *name) { return (bool)(Unlink(name) == 0); }
 };
 
 #else // FILESYS
+// The first sector of the disk describes the file system, so that it
+// can be checked against the disk, and sized, when Nachos starts up.
+
+class SuperBlock {
+public:
+    int magic;                // FileSystemMagic, once formatted
+    int sectorSize;            // Geometry of the disk when it was
+    int numTracks;            // formatted
+    int sectorsPerTrack;
+    int numSectors;            // Sectors the file system manages
+    int numDisks;            // How the volume is striped
+    int chunkSize;
+    int journalStart;            // Where the metadata journal is
+    int journalSize;
+};
+
+class BitMap;
+class Directory;
+class NameCache;
+class Journal;
 
 class FileSystem {
 public:
@@ -74,10 +94,14 @@ public:
     // If "format", there is nothing on
     // the disk, so initialize the directory
     // and the bitmap of free blocks.
+    ~FileSystem();            // Close the bitmap and directory
+    // files; Sync first
 
     bool Create(char *name, int initialSize);
     // Create a file (UNIX creat)
 
+    bool MakeDirectory(char *name);    // Create a directory (UNIX mkdir)
+
     OpenFile *Open(char *name);    // Open a file (UNIX open)
 
     bool Remove(char *name);        // Delete a file (UNIX unlink)
@@ -86,11 +110,46 @@ public:
 
     void Print();            // List all the files and their contents
 
+    void Sync();            // Write everything cached to disk
+
+    BitMap *GetFreeMap() { return freeMap; }
+    // The in-memory bitmap of free blocks;
+    // call FreeMapChanged after changing it
+    void FreeMapChanged() { Changed(TRUE, FALSE); }
+
+    void BeginUpdate();            // Bracket a change to file headers
+    void EndUpdate();            // or the bitmap, so it is journaled
+
 private:
+    bool CreateEntry(char *path, int initialSize, bool isDir);
+    int AllocateHeader(int dirSector, int dataSectors, bool isDir);
+    // Place the header of a new file
+    int FindParent(char *path, char *name);
+    // Find the directory holding "path"
+    int LookupIn(int dirSector, char *name, bool *isDir);
+    Directory *FetchDirectory(int sector, OpenFile **file);
+    void ReleaseDirectory(Directory *dir, OpenFile *file, bool changed);
+
+    void Changed(bool mapChanged, bool dirChanged);
+    // Note a change to the bitmap and/or
+    // directory, committing every so often
+    void Flush();            // Write back the bitmap and directory,
+    // and commit the batch
+    void WriteBack();            // Write back the bitmap and directory,
+    // if they have changed
+
     OpenFile *freeMapFile;        // Bit map of free disk blocks,
     // represented as a file
     OpenFile *directoryFile;        // "Root" directory -- list of
     // file names, represented as a file
+    BitMap *freeMap;            // In-memory copy of the bitmap,
+    Directory *directory;        // ... and of the root directory
+    NameCache *nameCache;        // Recent lookups in subdirectories
+    bool freeMapDirty;            // changed since last written back?
+    bool directoryDirty;
+    int numChanges;            // changes since last committed
+    SuperBlock superBlock;        // Describes the disk, as formatted
+    Journal *journal;            // Where metadata changes go first
 };
 
 #endif // FILESYS
@@ -7,6 +7,8 @@
 //	   Perftest -- a stress test for the Nachos file system
 //		read and write a really large file in tiny chunks
 //		(won't work on baseline system!)
+//	   CrashTest, RecoveryTest -- stop Nachos partway through
+//		writing files, then check they come back consistent
 //
 // Copyright (c) 1992-1993 The Regents of the University of California.
 // All rights reserved.  See copyright.h for copyright notice and limitation 
@@ -183,3 +185,122 @@ PerformanceTest()
     stats->Print();
 }
 
+
+//----------------------------------------------------------------------
+// CrashTest/RecoveryTest
+// 	Check that the file system comes back consistent after a crash.
+//	Run "nachos -crash", then "nachos -recover", with the same disk
+//	flags (-lfs, -raid) both times.
+//
+//	CrashTest writes a file and syncs it, then creates and writes
+//	CrashFiles more -- enough that several batches of metadata are
+//	committed to the journal, and, with -lfs, that segments are
+//	written after the checkpoint -- and stops Nachos without a sync.
+//
+//	RecoveryTest mounts the file system, which replays the journal
+//	(and, with -lfs, the segment summaries).  The synced file must be
+//	intact.  The others may or may not have survived, but none may
+//	share a sector with a new file: one is written until the disk is
+//	full, and the old files must not have changed.
+//----------------------------------------------------------------------
+
+#define CrashFiles	12
+#define CrashFileSize	300		// a few sectors each
+
+// The contents of crash test file number "n"
+static void
+CrashContents(char *buffer, int n)
+{
+    for (int i = 0; i < CrashFileSize; i++)
+	buffer[i] = 'a' + (i + n) % 26;
+}
+
+static void
+CrashName(char *name, int n)
+{
+    if (n == 0)
+	strcpy(name, "CrashSynced");
+    else
+	sprintf(name, "Crash%d", n);
+}
+
+void
+CrashTest()
+{
+    char name[20], buffer[CrashFileSize];
+    OpenFile *openFile;
+
+    for (int n = 0; n <= CrashFiles; n++) {
+	CrashName(name, n);
+	CrashContents(buffer, n);
+	if (!fileSystem->Create(name, 0)
+		|| (openFile = fileSystem->Open(name)) == NULL) {
+	    printf("Crash test: can't create %s\n", name);
+	    return;
+	}
+	if (openFile->Write(buffer, CrashFileSize) < CrashFileSize)
+	    printf("Crash test: unable to write %s\n", name);
+	delete openFile;
+	if (n == 0)
+	    fileSystem->Sync();
+    }
+    printf("Crash test: stopping without a sync\n");
+    Exit(0);				// not Cleanup: nothing is flushed
+}
+
+void
+RecoveryTest()
+{
+    char name[20], expected[CrashFileSize];
+    char (*before)[CrashFileSize] = new char[CrashFiles + 1][CrashFileSize];
+    char *buffer = new char[CrashFileSize];
+    int length[CrashFiles + 1];
+    OpenFile *openFile;
+    int n, survivors = 0, failures = 0;
+
+    for (n = 0; n <= CrashFiles; n++) {	// what is there now
+	CrashName(name, n);
+	length[n] = -1;
+	if ((openFile = fileSystem->Open(name)) == NULL)
+	    continue;
+	length[n] = openFile->Read(before[n], CrashFileSize);
+	delete openFile;
+	survivors++;
+    }
+    CrashContents(expected, 0);
+    if (length[0] != CrashFileSize
+	    || bcmp(before[0], expected, CrashFileSize) != 0) {
+	printf("Recovery test: synced file lost\n");
+	failures++;
+    }
+
+    // fill the disk: a sector still in use, but free in the bitmap,
+    // will be taken
+    memset(buffer, '#', CrashFileSize);
+    if (fileSystem->Create("CrashFiller", 0)
+	    && (openFile = fileSystem->Open("CrashFiller")) != NULL) {
+	while (openFile->Write(buffer, CrashFileSize) == CrashFileSize)
+	    ;
+	delete openFile;
+	fileSystem->Remove("CrashFiller");
+    }
+
+    for (n = 0; n <= CrashFiles; n++) {
+	CrashName(name, n);
+	if (length[n] == -1)
+	    continue;
+	if ((openFile = fileSystem->Open(name)) == NULL
+		|| openFile->Read(buffer, CrashFileSize) != length[n]
+		|| bcmp(buffer, before[n], length[n]) != 0) {
+	    printf("Recovery test: %s shares sectors with another file\n",
+		   name);
+	    failures++;
+	}
+	if (openFile != NULL)
+	    delete openFile;
+    }
+    printf("Recovery test: %d of %d files survived, %d failures\n",
+	   survivors, CrashFiles + 1, failures);
+    delete [] before;
+    delete [] buffer;
+}
@@ -0,0 +1,476 @@
+// journal.cc
+//	Routines to manage the metadata journal.
+//
+//	The journal region is used from its front: transactions are
+//	appended one after another, and a checkpoint writes all of them
+//	home at once, so the next transaction starts at the front again.
+//	A checkpoint is started by the checkpoint thread once the journal
+//	is half full, or done on the spot if a commit finds it full.
+//
+//	The file system writes its metadata back by the end of each
+//	update, so between updates the running transaction is consistent,
+//	and may be committed.  During one it may not: a file header might
+//	be in it without the bitmap that goes with it.  So a commit asked
+//	for during an update waits for the end of it, and the buffer cache
+//	keeps the sectors in the running transaction (which is to say,
+//	with their newest contents nowhere else on disk) out of their
+//	homes until then.
+//
+//	Journal I/O goes straight to the volume, not through the buffer
+//	cache, since nothing reads the journal back but Recover.  A
+//	committed transaction keeps its own copy of each sector until the
+//	checkpoint, so a sector changed again since (and not committed
+//	yet) doesn't get home early.  If the buffer cache writes a sector
+//	home first, with contents at least as new, the checkpoint can
+//	leave it alone.
+//
+// Copyright (c) 1992-1993 The Regents of the University of California.
+// All rights reserved.  See copyright.h for copyright notice and limitation
+// of liability and disclaimer of warranty provisions.
+
+#include "copyright.h"
+#include "journal.h"
+#include "system.h"
+
+#define HeaderMagic        0x4a484452    // "JHDR"
+#define DescriptorMagic    0x4a445343    // "JDSC"
+#define CommitMagic        0x4a434d54    // "JCMT"
+
+// A descriptor sector is DescriptorWords ints -- magic, sequence number,
+// sector count -- followed by the home sector numbers.
+#define DescriptorWords    3
+
+//----------------------------------------------------------------------
+// CheckpointThread
+// 	Entry point of the checkpoint thread.  Need this to be a C
+//	routine, because C++ can't handle pointers to member functions.
+//----------------------------------------------------------------------
+
+static void
+CheckpointThread(_int arg) {
+    Journal *journal = (Journal *) arg;
+
+    journal->CheckpointLoop();
+}
+
+//----------------------------------------------------------------------
+// Journal::Journal
+// 	Set up the journal in sectors [firstSector, firstSector +
+//	numSectors) of the volume.  A new journal is cleared, so nothing
+//	left over in the region can be taken for a transaction; an
+//	existing one is replayed.  Either way, it then starts out empty.
+//
+//	Must be called before anything is read from the file system, and
+//	before the buffer cache is told about the journal.
+//
+//	"format" -- is this a new file system?
+//----------------------------------------------------------------------
+
+Journal::Journal(int firstSector, int numSectors, bool format) {
+    start = firstSector;
+    size = numSectors;
+    maxSectors = min(SectorSize / (int) sizeof(int) - DescriptorWords,
+                     size - 3);
+    ASSERT(maxSectors > 0);
+    depth = 0;
+    updater = NULL;
+    commitWanted = FALSE;
+    head = 1;
+    numRunning = 0;
+    running = new int[maxSectors];
+    runningData = new char[maxSectors * SectorSize];
+    oldest = newest = NULL;
+    lock = new Lock("journal");
+    updateDone = new Condition("journal update done");
+    checkpointWanted = new Condition("journal checkpoint");
+    exiting = FALSE;
+
+    if (format) {
+        char *empty = new char[size * SectorSize];
+
+        bzero(empty, size * SectorSize);
+        volume->WriteSectors(start, empty, size);
+        delete[] empty;
+        nextSeq = 1;
+        WriteHeader();
+    } else
+        Recover();
+
+    checkpointer = new Thread("checkpoint");
+    checkpointer->Fork(CheckpointThread, (_int) this);
+}
+
+//----------------------------------------------------------------------
+// Journal::~Journal
+// 	Throw the journal away.  It must be empty -- committed and
+//	checkpointed by FileSystem::Sync -- since this runs as Nachos
+//	halts, when no thread is left to wait for the disk.
+//
+//	Tell the checkpoint thread to return before its lock and
+//	condition go away, rather than leave it waiting on them.
+//----------------------------------------------------------------------
+
+Journal::~Journal() {
+    ASSERT(numRunning == 0 && oldest == NULL);
+    lock->Acquire();
+    exiting = TRUE;
+    checkpointWanted->Signal(lock);
+    lock->Release();
+    delete checkpointWanted;
+    delete updateDone;
+    delete lock;
+    delete[] running;
+    delete[] runningData;
+}
+
+//----------------------------------------------------------------------
+// Journal::Begin/End
+// 	Bracket an update to the file system metadata.  Sectors the
+//	calling thread writes in between belong to the running
+//	transaction.  A commit asked for during the update happens at the
+//	end of it, so the update is committed whole.
+//
+//	Only one thread makes an update at a time; others wait in Begin.
+//	If the running transaction is already more than half full, it is
+//	committed before the update starts, so there is room for it.
+//----------------------------------------------------------------------
+
+void
+Journal::Begin() {
+    lock->Acquire();
+    while (depth > 0 && updater != currentThread)
+        updateDone->Wait(lock);
+    updater = currentThread;
+    if (depth++ == 0 && numRunning > maxSectors / 2)
+        DoCommit();
+    lock->Release();
+}
+
+void
+Journal::End() {
+    lock->Acquire();
+    ASSERT(depth > 0 && updater == currentThread);
+    if (--depth == 0) {
+        updater = NULL;
+        if (commitWanted)
+            DoCommit();
+        updateDone->Broadcast(lock);
+    }
+    lock->Release();
+}
+
+//----------------------------------------------------------------------
+// Journal::Logging
+// 	Return TRUE if the current thread is making an update, so the
+//	sectors it writes are to be journaled.  Other threads' writes
+//	(file data, say) are not.
+//----------------------------------------------------------------------
+
+bool
+Journal::Logging() {
+    return depth > 0 && updater == currentThread;
+}
+
+//----------------------------------------------------------------------
+// Journal::Log
+// 	Add the new contents of a sector to the running transaction.  A
+//	sector already in it is just updated.  If the transaction is
+//	full -- which only an update too big for one transaction can make
+//	it -- it is committed first, and the update is split over two.
+//
+//	"sector" -- the home sector
+//	"data" -- its new contents
+//----------------------------------------------------------------------
+
+void
+Journal::Log(int sector, char *data) {
+    int i;
+
+    lock->Acquire();
+    for (i = 0; i < numRunning && running[i] != sector; i++)
+        ;
+    if (i == numRunning) {
+        if (numRunning == maxSectors) {
+            DEBUG('f', "Journal: transaction full, committing early\n");
+            DoCommit();
+        }
+        i = numRunning++;
+        running[i] = sector;
+    }
+    bcopy(data, &runningData[i * SectorSize], SectorSize);
+    lock->Release();
+}
+
+//----------------------------------------------------------------------
+// Journal::Pinned
+// 	Return TRUE if "sector" is in the running transaction while an
+//	update is in progress.  The buffer cache must not write it home
+//	yet, as that would mean committing part of the update.
+//----------------------------------------------------------------------
+
+bool
+Journal::Pinned(int sector) {
+    bool pinned = FALSE;
+    int i;
+
+    lock->Acquire();
+    if (depth > 0)
+        for (i = 0; i < numRunning && !pinned; i++)
+            pinned = (running[i] == sector);
+    lock->Release();
+    return pinned;
+}
+
+//----------------------------------------------------------------------
+// Journal::WritingHome
+// 	The buffer cache is about to write "sector" to its home location.
+//	If its latest contents are in the running transaction, commit that
+//	first: nothing goes home before it is in the journal.  (Unless the
+//	sector is Pinned, which the buffer cache avoids, no update has
+//	written to the running transaction since it was last consistent.)
+//	Once it is home, the checkpoint needn't write it.
+//----------------------------------------------------------------------
+
+void
+Journal::WritingHome(int sector) {
+    Transaction *t;
+    int i;
+
+    lock->Acquire();
+    for (i = 0; i < numRunning; i++)
+        if (running[i] == sector) {
+            DoCommit();
+            break;
+        }
+    for (t = oldest; t != NULL; t = t->next)
+        for (i = 0; i < t->count; i++)
+            if (t->sectors[i] == sector)
+                t->sectors[i] = -1;
+    lock->Release();
+}
+
+//----------------------------------------------------------------------
+// Journal::Commit/Checkpoint
+// 	Commit the running transaction (or, if an update is in progress,
+//	note that it is to be committed when the update is done); write
+//	everything committed home.
+//----------------------------------------------------------------------
+
+void
+Journal::Commit() {
+    if (depth > 0) {
+        commitWanted = TRUE;
+        return;
+    }
+    lock->Acquire();
+    DoCommit();
+    lock->Release();
+}
+
+void
+Journal::Checkpoint() {
+    lock->Acquire();
+    DoCheckpoint();
+    lock->Release();
+}
+
+//----------------------------------------------------------------------
+// Journal::DoCommit
+// 	Append the running transaction to the journal: the descriptor and
+//	the sectors as one request, then the commit sector, so the commit
+//	can't reach the disk before what it commits.  Checkpoint first if
+//	there isn't room.  Called with the lock held.
+//----------------------------------------------------------------------
+
+void
+Journal::DoCommit() {
+    int n = numRunning;
+    char *buf;
+    int *words;
+    Transaction *t;
+
+    commitWanted = FALSE;
+    if (n == 0)
+        return;
+    if (head + n + 2 > size)
+        DoCheckpoint();
+    DEBUG('f', "Journal: committing transaction %d, %d sectors at %d\n",
+          nextSeq, n, head);
+
+    buf = new char[(n + 1) * SectorSize];
+    bzero(buf, SectorSize);
+    words = (int *) buf;
+    words[0] = DescriptorMagic;
+    words[1] = nextSeq;
+    words[2] = n;
+    bcopy((char *) running, (char *) &words[DescriptorWords],
+          n * sizeof(int));
+    bcopy(runningData, &buf[SectorSize], n * SectorSize);
+    volume->WriteSectors(start + head, buf, n + 1);
+    bzero(buf, SectorSize);
+    words[0] = CommitMagic;
+    words[1] = nextSeq;
+    volume->WriteSector(start + head + n + 1, buf);
+    delete[] buf;
+
+    // keep the sectors until they are checkpointed, and start afresh
+    t = new Transaction;
+    t->seq = nextSeq++;
+    t->count = n;
+    t->sectors = running;
+    t->data = runningData;
+    t->next = NULL;
+    if (newest == NULL)
+        oldest = t;
+    else
+        newest->next = t;
+    newest = t;
+    running = new int[maxSectors];
+    runningData = new char[maxSectors * SectorSize];
+    numRunning = 0;
+    head += n + 2;
+    stats->numJournalCommits++;
+    stats->numJournalSectors += n;
+
+    if (head > size / 2)
+        checkpointWanted->Signal(lock);
+}
+
+//----------------------------------------------------------------------
+// Journal::DoCheckpoint
+// 	Write the latest committed contents of each sector home -- those
+//	the buffer cache hasn't written since -- as one batch, so the
+//	volume can order them to suit the heads.  Then mark the journal
+//	empty, and free the transactions.  Called with the lock held.
+//----------------------------------------------------------------------
+
+void
+Journal::DoCheckpoint() {
+    int *sectors = new int[size];
+    char **contents = new char *[size];
+    VolumeRequest **requests;
+    Transaction *t;
+    int i, j, count = 0;
+
+    if (oldest == NULL) {
+        delete[] sectors;
+        delete[] contents;
+        return;
+    }
+    for (t = oldest; t != NULL; t = t->next)    // newer contents win
+        for (i = 0; i < t->count; i++) {
+            if (t->sectors[i] == -1)
+                continue;
+            for (j = 0; j < count && sectors[j] != t->sectors[i]; j++)
+                ;
+            if (j == count)
+                sectors[count++] = t->sectors[i];
+            contents[j] = &t->data[i * SectorSize];
+        }
+    DEBUG('f', "Journal: checkpointing %d sectors\n", count);
+
+    requests = new VolumeRequest *[count];
+    for (i = 0; i < count; i++)
+        requests[i] = volume->WriteAsync(sectors[i], contents[i]);
+    volume->WaitAll(requests, count);
+    volume->Sync();                     // home first, then forget them
+
+    while (oldest != NULL) {
+        t = oldest;
+        oldest = t->next;
+        delete[] t->sectors;
+        delete[] t->data;
+        delete t;
+    }
+    newest = NULL;
+    head = 1;
+    WriteHeader();
+    stats->numCheckpoints++;
+    delete[] requests;
+    delete[] sectors;
+    delete[] contents;
+}
+
+//----------------------------------------------------------------------
+// Journal::CheckpointLoop
+// 	Checkpoint whenever the journal gets half full, until the
+//	journal is deleted.
+//----------------------------------------------------------------------
+
+void
+Journal::CheckpointLoop() {
+    lock->Acquire();
+    while (!exiting) {
+        if (head > size / 2)
+            DoCheckpoint();
+        else
+            checkpointWanted->Wait(lock);
+    }
+    lock->Release();
+}
+
+//----------------------------------------------------------------------
+// Journal::WriteHeader
+// 	Record in the first sector of the region that the journal is
+//	empty, and which sequence number the next transaction will have
+//	-- so transactions left over from before, with smaller numbers,
+//	are not replayed.
+//----------------------------------------------------------------------
+
+void
+Journal::WriteHeader() {
+    char buf[SectorSize];
+    int *words = (int *) buf;
+
+    bzero(buf, SectorSize);
+    words[0] = HeaderMagic;
+    words[1] = nextSeq;
+    volume->WriteSector(start, buf);
+}
+
+//----------------------------------------------------------------------
+// Journal::Recover
+// 	Replay the transactions committed since the last checkpoint, in
+//	order, stopping at the first one that is missing, torn (no commit
+//	sector) or stale (the wrong sequence number).  The sectors go
+//	home through the buffer cache, which is then synced; then the
+//	journal is marked empty.
+//----------------------------------------------------------------------
+
+void
+Journal::Recover() {
+    char *desc = new char[SectorSize];
+    char *buf = new char[(maxSectors + 1) * SectorSize];
+    int *words = (int *) desc;
+    int *commit;
+    int n, i, pos = 1, replayed = 0;
+
+    volume->ReadSector(start, desc);
+    ASSERT(words[0] == HeaderMagic);
+    nextSeq = words[1];
+
+    while (pos + 2 <= size) {
+        volume->ReadSector(start + pos, desc);
+        n = words[2];
+        if (words[0] != DescriptorMagic || words[1] != nextSeq
+                || n < 1 || n > maxSectors || pos + n + 2 > size)
+            break;
+        volume->ReadSectors(start + pos + 1, buf, n + 1);
+        commit = (int *) &buf[n * SectorSize];
+        if (commit[0] != CommitMagic || commit[1] != nextSeq)
+            break;
+        DEBUG('f', "Journal: replaying transaction %d, %d sectors\n",
+              nextSeq, n);
+        for (i = 0; i < n; i++)
+            bufferCache->WriteSector(words[DescriptorWords + i],
+                                     &buf[i * SectorSize]);
+        replayed++;
+        nextSeq++;
+        pos += n + 2;
+    }
+    if (replayed > 0)
+        bufferCache->Sync();
+    WriteHeader();
+    delete[] desc;
+    delete[] buf;
+}
@@ -0,0 +1,127 @@
+// journal.h
+//	Data structures for a write-ahead journal of file system metadata.
+//
+//	Without it, each file system operation updates file headers,
+//	directory sectors and the bitmap where they live, scattered over
+//	the disk.  With it, those updates are first appended to a journal:
+//	a contiguous region of the disk, written sequentially.  Updates
+//	from many operations are gathered into one transaction and
+//	committed together (group commit), with a single run of writes.
+//	Only later, in the background, are the sectors checkpointed --
+//	written to their home locations -- after which their space in the
+//	journal can be reused.  A sector updated by several transactions
+//	meanwhile goes home just once.
+//
+//	If Nachos stops before a checkpoint, the committed transactions
+//	are replayed from the journal when the file system is next
+//	mounted; an operation is on disk either whole or not at all
+//	(unless it was too big for one transaction).  File data is not
+//	journaled; it goes straight through the buffer cache as before.
+//
+//	For that, a transaction is only ever committed between updates,
+//	and the sectors an update has written can't go home before it is
+//	done.  Updates are made one thread at a time, and only the
+//	sectors written by the thread making one are journaled.
+//
+//	On disk, the first sector of the region holds the sequence number
+//	of the first transaction since the last checkpoint, which comes
+//	right after it.  A transaction is a descriptor sector, listing the
+//	home sectors it updates, then the new contents of those sectors,
+//	then a commit sector.  Both the descriptor and the commit carry
+//	the transaction's sequence number, so a torn or stale transaction
+//	is never replayed.
+//
+// Copyright (c) 1992-1993 The Regents of the University of California.
+// All rights reserved.  See copyright.h for copyright notice and limitation
+// of liability and disclaimer of warranty provisions.
+
+#include "copyright.h"
+
+#ifndef JOURNAL_H
+#define JOURNAL_H
+
+#include "disk.h"
+#include "synch.h"
+
+#define JournalSectors	64		// size of the journal region
+
+// A committed transaction, kept in memory until it is checkpointed.
+
+class Transaction {
+  public:
+    int seq;				// sequence number
+    int count;				// home sectors it updates
+    int *sectors;			// which they are, or -1 once the
+					// buffer cache has written them home
+    char *data;				// and their new contents
+    Transaction *next;			// next newer transaction
+};
+
+// The following class defines the journal.  The file system brackets
+// each update with Begin and End; while an update is in progress, the
+// buffer cache hands every sector its thread writes to Log.  The buffer
+// cache leaves the sectors that are Pinned where they are, and calls
+// WritingHome before it writes any other sector to its home location,
+// so nothing goes home before its transaction is committed.
+
+class Journal {
+  public:
+    Journal(int firstSector, int numSectors, bool format);
+					// Use sectors [firstSector,
+					// firstSector + numSectors)
+					// for the journal; if not "format",
+					// replay what is there first
+    ~Journal();				// The journal must be empty:
+					// Checkpoint first
+
+    void Begin();			// An update starts,
+    void End();				// ... and is done; these nest
+    bool Logging();			// Is the current thread making an
+					// update?
+
+    void Log(int sector, char *data);	// Add a sector to the running
+					// transaction
+    bool Pinned(int sector);		// Must a sector stay out of its
+					// home until an update is done?
+    void WritingHome(int sector);	// The buffer cache is about to write
+					// a sector home
+    void Commit();			// Write the running transaction to
+					// the journal, once no update is
+					// in progress
+    void Checkpoint();			// Write committed sectors home, and
+					// free up the journal
+
+    void CheckpointLoop();		// Body of the checkpoint thread;
+					// returns once the journal is
+					// being deleted
+
+  private:
+    void DoCommit();			// Commit, with the lock held
+    void DoCheckpoint();		// Checkpoint, with the lock held
+    void WriteHeader();			// Record that the journal is empty
+    void Recover();			// Replay committed transactions
+
+    int start, size;			// The journal region
+    int maxSectors;			// Most sectors in one transaction
+    int depth;				// Updates in progress, nested,
+    Thread *updater;			// ... by this thread
+    bool commitWanted;			// Commit when they are done?
+    int nextSeq;			// Sequence number of the next commit
+    int head;				// Where in the region it goes
+
+    int numRunning;			// The running transaction: its
+    int *running;			// sectors, and their contents
+    char *runningData;
+
+    Transaction *oldest, *newest;	// Committed, not checkpointed
+
+    Lock *lock;				// Protects all of the above
+    Condition *updateDone;		// Signalled when no update is in
+					// progress
+    Condition *checkpointWanted;	// Signalled when the journal is
+					// getting full
+    Thread *checkpointer;		// The checkpoint thread
+    bool exiting;			// Should it return?
+};
+
+#endif // JOURNAL_H
@@ -0,0 +1,518 @@
+// logvolume.cc
+//	Routines to keep the file system in a log.
+//
+//	The current segment is filled in memory, and written out as one
+//	request when it is full, or (just the new part) at a Sync.  It is
+//	then sealed, and the next free segment after it becomes current,
+//	so the log sweeps across the disk.
+//
+//	A segment is free once none of the sectors in it are live.  It is
+//	only reused after the segment that was current before it has been
+//	written, so whatever replaced its sectors is on disk first.  The
+//	checkpoint records the sequence number of the last sealed segment;
+//	the segments after that are replayed from their summaries.
+//
+//	Reads of sectors still in the current segment come from memory;
+//	others go to the disk, a run at a time where the sectors happen
+//	to be together in the log.
+//
+//	The log's own I/O calls Volume::ReadAsync/WriteAsync by name;
+//	ReadSectors and the rest would come back here.
+//
+// Copyright (c) 1992-1993 The Regents of the University of California.
+// All rights reserved.  See copyright.h for copyright notice and limitation
+// of liability and disclaimer of warranty provisions.
+
+#include "copyright.h"
+#include "logvolume.h"
+#include "system.h"
+
+#define SegmentMagic	0x4c534547	// "LSEG"
+#define CheckpointMagic	0x4c43504b	// "LCPK"
+
+// A segment summary is SummaryWords ints -- magic, sequence number,
+// sector count -- followed by the logical sector in each slot.  The
+// checkpoint is CheckpointWords ints -- magic, sequence number of the
+// last segment it covers, number of logical sectors -- then the map.
+#define SummaryWords	3
+#define CheckpointWords	3
+
+// How many segments are held back from the file system, so the cleaner
+// can always find one worth cleaning: at least MinReserve, or one in
+// ReserveFraction on larger disks.
+#define MinReserve	4
+#define ReserveFraction	4
+
+//----------------------------------------------------------------------
+// CleanerThread
+// 	Entry point of the cleaner thread.  Need this to be a C routine,
+//	because C++ can't handle pointers to member functions.
+//----------------------------------------------------------------------
+
+static void
+CleanerThread(_int arg)
+{
+    LogVolume *log = (LogVolume *) arg;
+
+    log->CleanLoop();
+}
+
+//----------------------------------------------------------------------
+// LogVolume::LogVolume
+// 	Lay out the log on the disks: the checkpoint region, big enough
+//	for the map, then as many segments as fit.  A new log starts out
+//	with every segment free, and their summaries cleared, so nothing
+//	left over on the disks can be replayed; an existing one is
+//	recovered.  Either way, a fresh checkpoint is then written.
+//
+//	"name", "diskCount", "chunkSectors" -- as for Volume::Volume
+//	"format" -- is this a new file system?
+//	"policy", "numTracks", "sectorsPerTrack", "flashChannels" -- for
+//	   each disk, as for SynchDisk::SynchDisk
+//----------------------------------------------------------------------
+
+LogVolume::LogVolume(char *name, int diskCount, int chunkSectors, bool format,
+		     DiskPolicy policy, int numTracks, int sectorsPerTrack,
+		     int flashChannels)
+    : Volume(name, diskCount, chunkSectors, policy, numTracks, sectorsPerTrack,
+	     flashChannels)
+{
+    int checkpointSegments, reserve, i;
+
+    segmentSize = SectorsPerTrack;
+    for (summarySectors = 1;
+	 (SummaryWords + segmentSize - summarySectors) * (int) sizeof(int)
+	     > summarySectors * SectorSize;
+	 summarySectors++)
+	;
+    slots = segmentSize - summarySectors;
+    ASSERT(slots > 0);
+
+    // the map has to fit in the checkpoint region, but how big it is
+    // depends on how much room that leaves for segments
+    for (checkpointSegments = 1; ; checkpointSegments++) {
+	numSegments = Volume::Size() / segmentSize - checkpointSegments;
+	reserve = max(MinReserve, numSegments / ReserveFraction);
+	ASSERT(numSegments > reserve);
+	numLogical = (numSegments - reserve) * slots;
+	checkpointSectors = divRoundUp((CheckpointWords + numLogical)
+				       * sizeof(int), SectorSize);
+	if (checkpointSectors <= checkpointSegments * segmentSize)
+	    break;
+    }
+    firstSegment = checkpointSegments * segmentSize;
+    cleanThreshold = reserve / 2 + 1;
+    DEBUG('d', "Log of %d segments of %d sectors, offering %d sectors\n",
+	  numSegments, segmentSize, numLogical);
+
+    map = new int[numLogical];
+    live = new int[numSegments];
+    buffer = new char[segmentSize * SectorSize];
+    summary = (int *) buffer;
+    current = -1;
+    cleaning = FALSE;
+    lock = new Lock("log volume");
+    cleanWanted = new Condition("log cleaner");
+
+    if (format) {
+	char *empty = new char[summarySectors * SectorSize];
+	VolumeRequest **requests = new VolumeRequest *[numSegments];
+
+	bzero(empty, summarySectors * SectorSize);
+	for (i = 0; i < numLogical; i++)
+	    map[i] = -1;
+	for (i = 0; i < numSegments; i++) {
+	    live[i] = 0;
+	    requests[i] = Volume::WriteAsync(SegmentStart(i), empty,
+					     summarySectors);
+	}
+	WaitAll(requests, numSegments);
+	delete [] requests;
+	delete [] empty;
+	nextSeq = 1;
+    } else
+	Recover();
+
+    lock->Acquire();
+    NextSegment();
+    WriteCheckpoint();
+    lock->Release();
+
+    cleaner = new Thread("log cleaner");
+    cleaner->Fork(CleanerThread, (_int) this);
+}
+
+//----------------------------------------------------------------------
+// LogVolume::~LogVolume
+// 	Throw the log away.  The current segment must have been written
+//	out by Sync already: this runs as Nachos halts, when no thread is
+//	left to wait for the disk.
+//----------------------------------------------------------------------
+
+LogVolume::~LogVolume()
+{
+    ASSERT(fill == flushed);
+    delete cleanWanted;
+    delete lock;
+    delete [] map;
+    delete [] live;
+    delete [] buffer;
+}
+
+//----------------------------------------------------------------------
+// LogVolume::ReadAsync
+// 	Queue a read of logical sectors, as for Volume::ReadAsync.  Each
+//	run of sectors that lie together in the log is read as one part
+//	of the request; sectors in the current segment are copied from
+//	memory, and sectors never written read as zeroes.
+//----------------------------------------------------------------------
+
+VolumeRequest *
+LogVolume::ReadAsync(int sectorNumber, char* data, int count,
+		     VoidFunctionPtr callWhenDone, _int callArg)
+{
+    VolumeRequest *request = NewRequest(callWhenDone, callArg);
+    int i, n, where;
+
+    ASSERT(sectorNumber >= 0 && count > 0
+	   && sectorNumber + count <= numLogical);
+    lock->Acquire();
+    request->pending = 1;		// not done till all parts are sent
+    for (i = 0; i < count; i += n) {
+	where = map[sectorNumber + i];
+	n = 1;
+	if (where < 0)
+	    bzero(&data[i * SectorSize], SectorSize);
+	else if (SegmentOf(where) == current)
+	    bcopy(&buffer[(where - SegmentStart(current)) * SectorSize],
+		  &data[i * SectorSize], SectorSize);
+	else {
+	    while (i + n < count && map[sectorNumber + i + n] == where + n)
+		n++;
+	    request->pending++;
+	    Volume::ReadAsync(where, &data[i * SectorSize], n, PartDone,
+			      (_int) request);
+	}
+    }
+    lock->Release();
+    PartDone((_int) request);
+    return request;
+}
+
+//----------------------------------------------------------------------
+// LogVolume::WriteAsync
+// 	Write logical sectors, by appending them to the log.  The request
+//	is done as soon as they are in the current segment; it only has to
+//	wait for the disk if that fills up.
+//----------------------------------------------------------------------
+
+VolumeRequest *
+LogVolume::WriteAsync(int sectorNumber, char* data, int count,
+		      VoidFunctionPtr callWhenDone, _int callArg)
+{
+    VolumeRequest *request = NewRequest(callWhenDone, callArg);
+
+    ASSERT(sectorNumber >= 0 && count > 0
+	   && sectorNumber + count <= numLogical);
+    lock->Acquire();
+    for (int i = 0; i < count; i++)
+	Append(sectorNumber + i, &data[i * SectorSize]);
+    lock->Release();
+    request->pending = 1;
+    PartDone((_int) request);
+    return request;
+}
+
+//----------------------------------------------------------------------
+// LogVolume::Sync
+// 	Put everything written so far on disk: the current segment, as
+//	far as it has got, and then the map.
+//----------------------------------------------------------------------
+
+void
+LogVolume::Sync()
+{
+    lock->Acquire();
+    WriteSegment();
+    WriteCheckpoint();
+    lock->Release();
+    Volume::Sync();
+}
+
+//----------------------------------------------------------------------
+// LogVolume::CleanLoop
+// 	Loop forever, cleaning segments whenever free ones run low.
+//----------------------------------------------------------------------
+
+void
+LogVolume::CleanLoop()
+{
+    lock->Acquire();
+    for (;;) {
+	cleanWanted->Wait(lock);
+	while (FreeSegments() < cleanThreshold && Clean())
+	    ;
+    }
+}
+
+//----------------------------------------------------------------------
+// LogVolume::Append
+// 	Add the new contents of a logical sector to the current segment,
+//	and write the segment out if that fills it.  The old copy is dead;
+//	if it was in the part of the current segment not written yet, it
+//	is just overwritten.  Called with the lock held.
+//
+//	"sector" -- the logical sector
+//	"data" -- its new contents
+//----------------------------------------------------------------------
+
+void
+LogVolume::Append(int sector, char *data)
+{
+    int where = map[sector];
+
+    if (where >= 0 && SegmentOf(where) == current
+	    && where - SegmentStart(current) - summarySectors >= flushed) {
+	bcopy(data, &buffer[(where - SegmentStart(current)) * SectorSize],
+	      SectorSize);
+	return;
+    }
+    if (where >= 0)
+	live[SegmentOf(where)]--;
+    summary[SummaryWords + fill] = sector;
+    bcopy(data, &buffer[(summarySectors + fill) * SectorSize], SectorSize);
+    map[sector] = SegmentStart(current) + summarySectors + fill;
+    live[current]++;
+    if (++fill == slots) {
+	WriteSegment();
+	NextSegment();
+    }
+}
+
+//----------------------------------------------------------------------
+// LogVolume::WriteSegment
+// 	Write out the part of the current segment that isn't on disk yet,
+//	with its summary.  A segment filled since it became current goes
+//	out whole, as one request.  Called with the lock held.
+//----------------------------------------------------------------------
+
+void
+LogVolume::WriteSegment()
+{
+    int start = SegmentStart(current);
+    VolumeRequest *requests[2];
+
+    if (fill == flushed)
+	return;
+    summary[2] = fill;
+    DEBUG('d', "Log: writing segment %d, slots %d to %d\n", current,
+	  flushed, fill);
+    if (flushed == 0)
+	Wait(Volume::WriteAsync(start, buffer, summarySectors + fill));
+    else {
+	requests[0] = Volume::WriteAsync(start, buffer, summarySectors);
+	requests[1] = Volume::WriteAsync(start + summarySectors + flushed,
+				&buffer[(summarySectors + flushed) * SectorSize],
+				fill - flushed);
+	WaitAll(requests, 2);
+    }
+    flushed = fill;
+    if (fill == slots)
+	stats->numSegmentsWritten++;
+}
+
+//----------------------------------------------------------------------
+// LogVolume::NextSegment
+// 	Make the next free segment after the current one current.  If that
+//	was the last free one, clean on the spot, so there is another
+//	when this one fills; if free segments are getting scarce, wake the
+//	cleaner.  Called with the lock held, once the current segment has
+//	been written.
+//----------------------------------------------------------------------
+
+void
+LogVolume::NextSegment()
+{
+    int segment = current, i;
+
+    for (i = 0; i < numSegments; i++) {
+	segment = (segment + 1) % numSegments;
+	if (segment != current && live[segment] == 0)
+	    break;
+    }
+    ASSERT(i < numSegments);		// the cleaner fell behind
+
+    current = segment;
+    fill = flushed = 0;
+    bzero(buffer, summarySectors * SectorSize);
+    summary[0] = SegmentMagic;
+    summary[1] = nextSeq++;
+    DEBUG('d', "Log: segment %d is current, sequence %d\n", current,
+	  summary[1]);
+
+    if (!cleaning)
+	while (FreeSegments() == 0 && Clean())
+	    ;
+    if (FreeSegments() < cleanThreshold)
+	cleanWanted->Signal(lock);
+}
+
+//----------------------------------------------------------------------
+// LogVolume::Clean
+// 	Free the segment with the fewest live sectors, by reading it
+//	whole and appending its live sectors to the log again.  Once the
+//	last has moved, it may already be current again.  Return
+//	FALSE if there is nothing to gain -- every segment in use is full
+//	of live sectors -- or nowhere to put them.  Called with the lock
+//	held.
+//----------------------------------------------------------------------
+
+bool
+LogVolume::Clean()
+{
+    int victim = -1, moved = 0, i, where;
+    char *contents;
+    int *sum;
+
+    for (i = 0; i < numSegments; i++)
+	if (i != current && live[i] > 0
+		&& (victim == -1 || live[i] < live[victim]))
+	    victim = i;
+    if (victim == -1 || live[victim] == slots)
+	return FALSE;
+    if (live[victim] > slots - fill && FreeSegments() == 0)
+	return FALSE;
+    DEBUG('d', "Log: cleaning segment %d, %d live sectors\n", victim,
+	  live[victim]);
+
+    contents = new char[segmentSize * SectorSize];
+    sum = (int *) contents;
+    Wait(Volume::ReadAsync(SegmentStart(victim), contents, segmentSize));
+    cleaning = TRUE;
+    for (i = 0; i < sum[2] && live[victim] > 0; i++) {
+	where = SegmentStart(victim) + summarySectors + i;
+	if (map[sum[SummaryWords + i]] == where) {
+	    Append(sum[SummaryWords + i],
+		   &contents[(summarySectors + i) * SectorSize]);
+	    moved++;
+	}
+    }
+    cleaning = FALSE;
+    ASSERT(live[victim] == 0);
+    stats->numSegmentsCleaned++;
+    stats->numCleanerMoves += moved;
+    delete [] contents;
+    return TRUE;
+}
+
+//----------------------------------------------------------------------
+// LogVolume::FreeSegments
+// 	Return how many segments hold no live sectors, and so can be
+//	reused.
+//----------------------------------------------------------------------
+
+int
+LogVolume::FreeSegments()
+{
+    int count = 0;
+
+    for (int i = 0; i < numSegments; i++)
+	if (i != current && live[i] == 0)
+	    count++;
+    return count;
+}
+
+//----------------------------------------------------------------------
+// LogVolume::WriteCheckpoint
+// 	Write the map to the checkpoint region.  It covers the segments
+//	sealed so far; the current one will be replayed, in case more is
+//	added to it.  Called with the lock held, once the segments have
+//	been written.
+//----------------------------------------------------------------------
+
+void
+LogVolume::WriteCheckpoint()
+{
+    char *buf = new char[checkpointSectors * SectorSize];
+    int *words = (int *) buf;
+
+    bzero(buf, checkpointSectors * SectorSize);
+    words[0] = CheckpointMagic;
+    words[1] = summary[1] - 1;
+    words[2] = numLogical;
+    bcopy((char *) map, (char *) &words[CheckpointWords],
+	  numLogical * sizeof(int));
+    Wait(Volume::WriteAsync(0, buf, checkpointSectors));
+    delete [] buf;
+}
+
+//----------------------------------------------------------------------
+// LogVolume::Recover
+// 	Read the map from the checkpoint region, then bring it up to date
+//	from the summaries of the segments written since, oldest first:
+//	where a sector was written more than once, the newest copy wins.
+//	Then count the live sectors in each segment.
+//----------------------------------------------------------------------
+
+void
+LogVolume::Recover()
+{
+    int summaryBytes = summarySectors * SectorSize;
+    char *buf = new char[checkpointSectors * SectorSize];
+    char *summaries = new char[numSegments * summaryBytes];
+    VolumeRequest **requests = new VolumeRequest *[numSegments];
+    int *order = new int[numSegments];
+    int *seqs = new int[numSegments];
+    int *words = (int *) buf;
+    int *sum;
+    int checkpointSeq, i, j, k, n = 0;
+
+    Wait(Volume::ReadAsync(0, buf, checkpointSectors));
+    ASSERT(words[0] == CheckpointMagic && words[2] == numLogical);
+    checkpointSeq = words[1];
+    bcopy((char *) &words[CheckpointWords], (char *) map,
+	  numLogical * sizeof(int));
+
+    for (i = 0; i < numSegments; i++)
+	requests[i] = Volume::ReadAsync(SegmentStart(i),
+					&summaries[i * summaryBytes],
+					summarySectors);
+    WaitAll(requests, numSegments);
+
+    for (i = 0; i < numSegments; i++) {	// sort the newer ones by sequence
+	sum = (int *) &summaries[i * summaryBytes];
+	if (sum[0] != SegmentMagic || sum[1] <= checkpointSeq
+		|| sum[2] < 0 || sum[2] > slots)
+	    continue;
+	for (j = n++; j > 0 && seqs[j - 1] > sum[1]; j--) {
+	    order[j] = order[j - 1];
+	    seqs[j] = seqs[j - 1];
+	}
+	order[j] = i;
+	seqs[j] = sum[1];
+    }
+    nextSeq = checkpointSeq + 1;
+    for (i = 0; i < n; i++) {
+	sum = (int *) &summaries[order[i] * summaryBytes];
+	DEBUG('d', "Log: replaying segment %d, sequence %d, %d sectors\n",
+	      order[i], sum[1], sum[2]);
+	for (k = 0; k < sum[2]; k++)
+	    if (sum[SummaryWords + k] >= 0
+		    && sum[SummaryWords + k] < numLogical)
+		map[sum[SummaryWords + k]] =
+		    SegmentStart(order[i]) + summarySectors + k;
+	nextSeq = sum[1] + 1;
+    }
+
+    for (i = 0; i < numSegments; i++)
+	live[i] = 0;
+    for (i = 0; i < numLogical; i++)
+	if (map[i] >= 0)
+	    live[SegmentOf(map[i])]++;
+
+    delete [] buf;
+    delete [] summaries;
+    delete [] requests;
+    delete [] order;
+    delete [] seqs;
+}
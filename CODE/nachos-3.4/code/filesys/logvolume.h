@@ -0,0 +1,112 @@
+// logvolume.h
+//	Data structures for a log-structured volume: the sectors of the
+//	file system are never updated in place, but appended to a log.
+//
+//	The disk is divided into segments, each one track long.  Sectors
+//	written by the file system -- file data, file headers, directories,
+//	the bitmap, the journal alike -- are gathered in memory into the
+//	current segment, and written out as one request when it fills:
+//	a whole track, in one seek.  Small scattered writes become large
+//	sequential ones.
+//
+//	Since a sector moves each time it is written, the volume keeps a
+//	map from each sector the file system sees (a "logical" sector) to
+//	where it is now.  The first sectors of each segment are its
+//	summary, listing which logical sector each of the others holds.
+//	The map is written to the checkpoint region at the front of the
+//	disk at each Sync; when the volume is next used, the summaries of
+//	the segments written since then are replayed in order, so nothing
+//	that reached the disk is lost.
+//
+//	As sectors are written again, the old copies die, and segments
+//	fill up with dead space.  The cleaner thread keeps a few segments
+//	free by copying the live sectors out of the emptiest segments and
+//	reusing them.  So that it always can, the volume offers the file
+//	system rather fewer sectors than the disk has.
+//
+// Copyright (c) 1992-1993 The Regents of the University of California.
+// All rights reserved.  See copyright.h for copyright notice and limitation
+// of liability and disclaimer of warranty provisions.
+
+#include "copyright.h"
+
+#ifndef LOGVOLUME_H
+#define LOGVOLUME_H
+
+#include "volume.h"
+#include "synch.h"
+
+// The following class defines the log-structured volume.  It stores
+// the log on a Volume (so it can be striped), and has the same
+// interface, so the buffer cache can't tell the difference.  Writes
+// are complete once they are in the current segment; Sync puts them
+// on disk.
+
+class LogVolume : public Volume {
+  public:
+    LogVolume(char *name, int diskCount, int chunkSectors, bool format,
+	      DiskPolicy policy = DiskCSCAN, int numTracks = 0,
+	      int sectorsPerTrack = 0, int flashChannels = 0);
+    					// Keep a log on the disks; if not
+					// "format", recover the map first
+    ~LogVolume();			// Everything must be out: Sync first
+
+    int Size() { return numLogical; }	// Sectors offered to the file system
+
+    VolumeRequest *ReadAsync(int sectorNumber, char* data, int count = 1,
+			     VoidFunctionPtr callWhenDone = NULL,
+			     _int callArg = 0);
+    VolumeRequest *WriteAsync(int sectorNumber, char* data, int count = 1,
+			      VoidFunctionPtr callWhenDone = NULL,
+			      _int callArg = 0);
+    void Sync();			// Write the current segment and the
+					// map, then sync the disks
+
+    void CleanLoop();			// Body of the cleaner thread
+
+  private:
+    void Append(int sector, char *data);
+    					// Add a sector to the log
+    void WriteSegment();		// Write out the current segment
+    void NextSegment();			// Start filling a free segment
+    bool Clean();			// Empty the segment with the fewest
+					// live sectors
+    int FreeSegments();			// How many segments are free
+    void WriteCheckpoint();		// Write the map
+    void Recover();			// Read the map, and bring it up to
+					// date from the segment summaries
+
+    int SegmentStart(int segment)	// First sector of a segment
+	{ return firstSegment + segment * segmentSize; }
+    int SegmentOf(int where)		// Segment holding a sector
+	{ return (where - firstSegment) / segmentSize; }
+
+    int segmentSize;			// Sectors in a segment (one track)
+    int summarySectors;			// ... of which summary,
+    int slots;				// ... and logical sectors
+    int numSegments;			// Segments on the disk
+    int firstSegment;			// Where they start, after the
+    int checkpointSectors;		// ... checkpoint region
+    int numLogical;			// Logical sectors
+    int cleanThreshold;			// Wake the cleaner below this many
+					// free segments
+
+    int *map;				// Where each logical sector is, or
+					// -1 if it has never been written
+    int *live;				// Live sectors in each segment
+
+    int current;			// The segment being filled:
+    char *buffer;			// ... its contents, summary first,
+    int *summary;			// ... the summary,
+    int fill;				// ... slots used,
+    int flushed;			// ... and how many of them are on disk
+    int nextSeq;			// Sequence number of the next segment
+    bool cleaning;			// Is the cleaner copying sectors?
+
+    Lock *lock;				// Protects all of the above
+    Condition *cleanWanted;		// Signalled when free segments run
+					// low
+    Thread *cleaner;			// The cleaner thread
+};
+
+#endif // LOGVOLUME_H
@@ -64,6 +64,8 @@ int fileSector;
 
 class FileHeader;
 
+#define MaxReadAhead    16    // most sectors prefetched past a read
+
 class OpenFile {
 public:
     OpenFile(int sector);        // Open a file whose header is located
@@ -94,10 +96,22 @@ public:
     // end of file, tell, lseek back
 
 private:
+    void ReadAhead(int position, int lastSector);
+    // Adjust the read-ahead window after
+    // a read, and prefetch past the read
+    int WholeRun(int first, int position, int end);
+    // How many whole sectors, from the
+    // "first", are consecutive on disk
+
     FileHeader *hdr;            // Header for this file
     int seekPosition;            // Current position within the file
     // fileSector to record the sector when openFile
     int fileSector;
+    char *scratch;            // Holds a partially read/written sector
+    int sequentialPosition;        // Where the next read starts, if the
+    // file is being read sequentially
+    int readAheadWindow;        // Sectors to keep prefetched ahead
+    int prefetchedUpTo;            // First sector not yet prefetched
 };
 
 #endif // FILESYS
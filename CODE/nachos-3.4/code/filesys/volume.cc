@@ -0,0 +1,267 @@
+// volume.cc
+//	Routines to stripe a volume over several disks.  All the real work
+//	-- queueing, scheduling, waiting for interrupts -- is done by the
+//	SynchDisk of each disk; this only works out which disk each part
+//	of a request goes to, and notices when all the parts are done.
+//
+// Copyright (c) 1992-1993 The Regents of the University of California.
+// All rights reserved.  See copyright.h for copyright notice and limitation
+// of liability and disclaimer of warranty provisions.
+
+#include "copyright.h"
+#include "volume.h"
+#include "system.h"
+
+//----------------------------------------------------------------------
+// Volume::PartDone
+// 	Called from the disk interrupt handler when one part of a volume
+//	request is done.  When the last part is, the request is.
+//----------------------------------------------------------------------
+
+void
+Volume::PartDone(_int arg)
+{
+    VolumeRequest *request = (VolumeRequest *) arg;
+
+    if (--request->pending > 0)
+	return;
+    if (request->callback != NULL) {
+	(*request->callback)(request->callbackArg);
+	delete request;
+    } else
+	request->done->V();
+}
+
+//----------------------------------------------------------------------
+// Volume::Volume
+// 	Initialize the disks of a volume.  The first disk decides the
+//	geometry; the others are made to match it.  The volume has as
+//	many whole stripes as fit on the disks.
+//
+//	"name" -- UNIX file name for the first disk (usually, "DISK")
+//	"diskCount" -- how many disks to stripe over
+//	"chunkSectors" -- how many consecutive sectors go to one disk
+//	"policy", "numTracks", "sectorsPerTrack", "flashChannels" -- for
+//	   each disk, as for SynchDisk::SynchDisk
+//----------------------------------------------------------------------
+
+Volume::Volume(char *name, int diskCount, int chunkSectors, DiskPolicy policy,
+	       int numTracks, int sectorsPerTrack, int flashChannels)
+{
+    char *diskName = new char[strlen(name) + 12];
+
+    ASSERT(diskCount > 0 && chunkSectors > 0);
+    numDisks = diskCount;
+    chunkSize = chunkSectors;
+    disks = new SynchDisk *[numDisks];
+    for (int i = 0; i < numDisks; i++) {
+	if (i == 0)
+	    strcpy(diskName, name);
+	else
+	    sprintf(diskName, "%s%d", name, i);
+	disks[i] = new SynchDisk(diskName, policy, numTracks,
+				 sectorsPerTrack, flashChannels);
+	numTracks = NumTracks;		// the rest look like the first
+	sectorsPerTrack = SectorsPerTrack;
+    }
+    delete [] diskName;
+
+    if (numDisks == 1)
+	numSectors = NumSectors;
+    else
+	numSectors = (NumSectors / chunkSize) * chunkSize * numDisks;
+    DEBUG('d', "Volume of %d sectors, over %d disks in chunks of %d\n",
+	  numSectors, numDisks, chunkSize);
+}
+
+//----------------------------------------------------------------------
+// Volume::~Volume
+// 	Shut down each disk.
+//----------------------------------------------------------------------
+
+Volume::~Volume()
+{
+    for (int i = 0; i < numDisks; i++)
+	delete disks[i];
+    delete [] disks;
+}
+
+//----------------------------------------------------------------------
+// Volume::ReadSector/WriteSector/ReadSectors/WriteSectors
+// 	Read/write sectors of the volume, returning once it is done.
+//
+//	"sectorNumber" -- the first sector to read/write
+//	"data" -- the buffer, "count" sectors long
+//----------------------------------------------------------------------
+
+void
+Volume::ReadSector(int sectorNumber, char* data)
+{
+    Wait(ReadAsync(sectorNumber, data));
+}
+
+void
+Volume::WriteSector(int sectorNumber, char* data)
+{
+    Wait(WriteAsync(sectorNumber, data));
+}
+
+void
+Volume::ReadSectors(int sectorNumber, char* data, int count)
+{
+    Wait(ReadAsync(sectorNumber, data, count));
+}
+
+void
+Volume::WriteSectors(int sectorNumber, char* data, int count)
+{
+    Wait(WriteAsync(sectorNumber, data, count));
+}
+
+//----------------------------------------------------------------------
+// Volume::ReadAsync/WriteAsync
+// 	Queue a read/write of sectors of the volume, and return without
+//	waiting for it, as for SynchDisk::ReadAsync.  The parts of the
+//	request on different disks go ahead at the same time.
+//----------------------------------------------------------------------
+
+VolumeRequest *
+Volume::ReadAsync(int sectorNumber, char* data, int count,
+		  VoidFunctionPtr callWhenDone, _int callArg)
+{
+    return Submit(sectorNumber, data, count, FALSE, callWhenDone, callArg);
+}
+
+VolumeRequest *
+Volume::WriteAsync(int sectorNumber, char* data, int count,
+		   VoidFunctionPtr callWhenDone, _int callArg)
+{
+    return Submit(sectorNumber, data, count, TRUE, callWhenDone, callArg);
+}
+
+//----------------------------------------------------------------------
+// Volume::Wait
+// 	Wait until a request from ReadAsync/WriteAsync has completed, and
+//	free it.
+//----------------------------------------------------------------------
+
+void
+Volume::Wait(VolumeRequest *request)
+{
+    ASSERT(request->callback == NULL);
+    request->done->P();
+    delete request->done;
+    delete request;
+}
+
+//----------------------------------------------------------------------
+// Volume::WaitAll
+// 	Wait until every request in a batch has completed.  Each disk
+//	serves its share of the batch in whatever order suits its head.
+//----------------------------------------------------------------------
+
+void
+Volume::WaitAll(VolumeRequest **requests, int count)
+{
+    for (int i = 0; i < count; i++)
+	Wait(requests[i]);
+}
+
+//----------------------------------------------------------------------
+// Volume::Sync
+// 	Make sure every write that has completed is in the UNIX files
+//	simulating the disks.
+//----------------------------------------------------------------------
+
+void
+Volume::Sync()
+{
+    for (int i = 0; i < numDisks; i++)
+	disks[i]->Sync();
+}
+
+//----------------------------------------------------------------------
+// Volume::Submit
+// 	Make a request: split it at chunk boundaries, and queue each part
+//	with the disk holding it.  All the parts are counted before any
+//	is sent, since one may finish before the last is sent.
+//----------------------------------------------------------------------
+
+VolumeRequest *
+Volume::Submit(int sectorNumber, char *data, int count, bool writing,
+	       VoidFunctionPtr callWhenDone, _int callArg)
+{
+    VolumeRequest *request = NewRequest(callWhenDone, callArg);
+    int i, n, sector, disk;
+
+    ASSERT(sectorNumber >= 0 && count > 0
+	   && sectorNumber + count <= numSectors);
+    for (i = 0; i < count; i += PartLength(sectorNumber + i, count - i))
+	request->pending++;
+    for (i = 0; i < count; i += n) {
+	n = PartLength(sectorNumber + i, count - i);
+	sector = Locate(sectorNumber + i, &disk);
+	if (writing)
+	    disks[disk]->WriteAsync(sector, &data[i * SectorSize], n,
+				    PartDone, (_int) request);
+	else
+	    disks[disk]->ReadAsync(sector, &data[i * SectorSize], n,
+				   PartDone, (_int) request);
+    }
+    return request;
+}
+
+//----------------------------------------------------------------------
+// Volume::NewRequest
+// 	Return a request with no parts yet, to complete by calling back,
+//	or (if no callback is given) by signalling its semaphore.  The
+//	caller counts the parts in "pending", and calls PartDone as each
+//	is done.
+//----------------------------------------------------------------------
+
+VolumeRequest *
+Volume::NewRequest(VoidFunctionPtr callWhenDone, _int callArg)
+{
+    VolumeRequest *request = new VolumeRequest;
+
+    request->pending = 0;
+    request->callback = callWhenDone;
+    request->callbackArg = callArg;
+    request->done = NULL;
+    if (callWhenDone == NULL)
+	request->done = new Semaphore("volume request", 0);
+    return request;
+}
+
+//----------------------------------------------------------------------
+// Volume::Locate
+// 	Return which sector of which disk (in "*disk") holds sector
+//	"sector" of the volume.
+//----------------------------------------------------------------------
+
+int
+Volume::Locate(int sector, int *disk)
+{
+    int chunk = sector / chunkSize;
+
+    if (numDisks == 1) {
+	*disk = 0;
+	return sector;
+    }
+    *disk = chunk % numDisks;
+    return (chunk / numDisks) * chunkSize + sector % chunkSize;
+}
+
+//----------------------------------------------------------------------
+// Volume::PartLength
+// 	Return how many of the "count" sectors from "sector" on lie in
+//	the same chunk, and so on the same disk, as the first.
+//----------------------------------------------------------------------
+
+int
+Volume::PartLength(int sector, int count)
+{
+    if (numDisks == 1)
+	return count;
+    return min(count, chunkSize - sector % chunkSize);
+}
@@ -0,0 +1,99 @@
+// volume.h
+//	Data structures for a striped volume: several simulated disks
+//	presented as one big one (RAID-0).
+//
+//	The volume's sectors are dealt out to the disks in chunks of
+//	"chunkSize" consecutive sectors: chunk 0 goes to disk 0, chunk 1 to
+//	disk 1, and so on round the disks.  Each disk is a SynchDisk of its
+//	own, with its own UNIX file, its own request queue and its own
+//	interrupts, so requests for sectors on different disks are served
+//	at the same time.  A request that spans several chunks is split
+//	into one request per chunk, and completes when they all have.
+//
+//	With a single disk there is no striping; the volume is just that
+//	disk.
+//
+// Copyright (c) 1992-1993 The Regents of the University of California.
+// All rights reserved.  See copyright.h for copyright notice and limitation
+// of liability and disclaimer of warranty provisions.
+
+#include "copyright.h"
+
+#ifndef VOLUME_H
+#define VOLUME_H
+
+#include "synchdisk.h"
+
+#define DefaultChunkSize	8	// sectors per chunk, unless "-raid"
+					// says
+
+// A request to the volume, as handed back by ReadAsync/WriteAsync.  It
+// completes when each of the requests it was split into has.
+
+class VolumeRequest {
+  public:
+    int pending;			// parts not yet done
+    VoidFunctionPtr callback;		// called when the request completes,
+    _int callbackArg;			// ... with this argument
+    Semaphore *done;			// signalled instead, if no callback
+};
+
+// The following class defines the volume.  It has the same interface
+// as SynchDisk, and a SynchDisk behind it for each disk.
+
+class Volume {
+  public:
+    Volume(char *name, int diskCount, int chunkSectors,
+	   DiskPolicy policy = DiskCSCAN, int numTracks = 0,
+	   int sectorsPerTrack = 0, int flashChannels = 0);
+    					// Stripe "diskCount" disks; the first
+					// is kept in UNIX file "name", the
+					// others in "name1", "name2", ...
+    virtual ~Volume();
+
+    virtual int Size() { return numSectors; }
+    					// Sectors in the volume
+    int NumDisks() { return numDisks; }
+    int ChunkSize() { return chunkSize; }
+
+    void ReadSector(int sectorNumber, char* data);
+    void WriteSector(int sectorNumber, char* data);
+    void ReadSectors(int sectorNumber, char* data, int count);
+    void WriteSectors(int sectorNumber, char* data, int count);
+    					// As for SynchDisk
+
+    virtual VolumeRequest *ReadAsync(int sectorNumber, char* data,
+				     int count = 1,
+				     VoidFunctionPtr callWhenDone = NULL,
+				     _int callArg = 0);
+    virtual VolumeRequest *WriteAsync(int sectorNumber, char* data,
+				      int count = 1,
+				      VoidFunctionPtr callWhenDone = NULL,
+				      _int callArg = 0);
+    void Wait(VolumeRequest *request);
+    void WaitAll(VolumeRequest **requests, int count);
+    					// As for SynchDisk
+
+    virtual void Sync();		// Sync every disk
+
+  protected:
+    VolumeRequest *NewRequest(VoidFunctionPtr callWhenDone, _int callArg);
+    					// A request to be done in parts
+    static void PartDone(_int arg);	// One part of a request is done
+
+  private:
+    VolumeRequest *Submit(int sectorNumber, char *data, int count,
+			  bool writing, VoidFunctionPtr callWhenDone,
+			  _int callArg);
+    					// Split a request up among the disks
+    int Locate(int sector, int *disk);	// Where a sector of the volume is
+    int PartLength(int sector, int count);
+    					// How much of a run lies in one chunk
+
+    SynchDisk **disks;			// The disks, in striping order
+    int numDisks;
+    int chunkSize;			// Consecutive sectors on one disk
+    int numSectors;			// Sectors in the volume
+};
+
+#endif // VOLUME_H
@@ -74,7 +74,7 @@ FileHeader::Deallocate(BitMap *freeMap) {
 
 void
 FileHeader::FetchFrom(int sector) {
-    synchDisk->ReadSector(sector, (char *) this);
+    bufferCache->ReadSector(sector, (char *) this);
 }
 
 //----------------------------------------------------------------------
@@ -86,7 +86,7 @@ FileHeader::FetchFrom(int sector) {
 
 void
 FileHeader::WriteBack(int sector) {
-    synchDisk->WriteSector(sector, (char *) this);
+    bufferCache->WriteSector(sector, (char *) this);
 }
 
 //----------------------------------------------------------------------
@@ -130,7 +130,7 @@ FileHeader::Print() {
         printf("%d ", dataSectors[i]);
     printf("\nFile contents:\n");
     for (i = k = 0; i < numSectors; i++) {
-        synchDisk->ReadSector(dataSectors[i], data);
+        bufferCache->ReadSector(dataSectors[i], data);
         for (j = 0; (j < SectorSize) && (k < numBytes); j++, k++) {
             if ('\040' <= data[j] && data[j] <= '\176')   // isprint(data[j])
                 printf("%c", data[j]);
@@ -159,7 +159,7 @@ int FileHeader::Extend(int newFileSize) {
     int appendSectorsNum = newNumSectors - numSectors;
     // bitmap is located in 0 sector
     OpenFile *bitmapFile = new OpenFile(0);
-    BitMap *freeMap = new BitMap(NumSectors);
+    BitMap *freeMap = new BitMap(volume->Size());
     freeMap->FetchFrom(bitmapFile);
     // similar to Allocate() function
     // if no more space to allocate new sectors, just return -1
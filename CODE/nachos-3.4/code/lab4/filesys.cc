@@ -50,6 +50,7 @@
 #include "directory.h"
 #include "filehdr.h"
 #include "filesys.h"
+#include "system.h"
 
 // Sectors containing the file headers for the bitmap of free sectors,
 // and the directory of files.  These file headers are placed in well-known 
@@ -59,8 +60,10 @@
 
 // Initial file sizes for the bitmap and directory; until the file system
 // supports extensible files, the directory size sets the maximum number 
-// of files that can be loaded onto the disk.
-#define FreeMapFileSize    (NumSectors / BitsInByte)
+// of files that can be loaded onto the disk.  The bitmap has a bit for
+// each sector of the volume, which need not be one disk (-raid, -lfs).
+#define FreeMapFileSize \
+    (divRoundUp(volume->Size(), BitsInWord) * (int) sizeof(unsigned))
 #define NumDirEntries        10
 #define DirectoryFileSize    (sizeof(DirectoryEntry) * NumDirEntries)
 
@@ -80,7 +83,7 @@
 FileSystem::FileSystem(bool format) {
     DEBUG('f', "Initializing the file system.\n");
     if (format) {
-        BitMap *freeMap = new BitMap(NumSectors);
+        BitMap *freeMap = new BitMap(volume->Size());
         Directory *directory = new Directory(NumDirEntries);
         FileHeader *mapHdr = new FileHeader;
         FileHeader *dirHdr = new FileHeader;
@@ -186,7 +189,7 @@ FileSystem::Create(char *name, int initialSize) {
     if (directory->Find(name) != -1)
         success = FALSE;            // file is already in directory
     else {
-        freeMap = new BitMap(NumSectors);
+        freeMap = new BitMap(volume->Size());
         freeMap->FetchFrom(freeMapFile);
         sector = freeMap->Find();    // find a sector to hold the file header
         if (sector == -1)
@@ -268,7 +271,7 @@ FileSystem::Remove(char *name) {
     fileHdr = new FileHeader;
     fileHdr->FetchFrom(sector);
 
-    freeMap = new BitMap(NumSectors);
+    freeMap = new BitMap(volume->Size());
     freeMap->FetchFrom(freeMapFile);
 
     fileHdr->Deallocate(freeMap);        // remove data blocks
@@ -311,7 +314,7 @@ void
 FileSystem::Print() {
     FileHeader *bitHdr = new FileHeader;
     FileHeader *dirHdr = new FileHeader;
-    BitMap *freeMap = new BitMap(NumSectors);
+    BitMap *freeMap = new BitMap(volume->Size());
     Directory *directory = new Directory(NumDirEntries);
 
     printf("Bit map file header:\n");
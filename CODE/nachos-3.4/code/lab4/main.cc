@@ -167,6 +167,10 @@ main(int argc, char **argv) {
 #endif // NETWORK
     }
 
+#ifdef FILESYS
+    bufferCache->Sync();        // while main can still wait for the disk:
+                                // Cleanup can't
+#endif
     currentThread->Finish();    // NOTE: if the procedure "main"
     // returns, then the program "nachos"
     // will exit (as any other normal program
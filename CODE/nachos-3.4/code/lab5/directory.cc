@@ -1,21 +1,21 @@
 // directory.cc 
 //	Routines to manage a directory of file names.
 //
-//	The directory is a table of fixed length entries; each
-//	entry represents a single file, and contains the file name,
-//	and the location of the file header on disk.  The fixed size
-//	of each directory entry means that we have the restriction
-//	of a fixed maximum size for file names.
+//	On disk, the directory is a count of entries followed by one
+//	variable-length record per file: the location of the file header
+//	on disk, whether the file is itself a directory, and the name,
+//	padded out to a word boundary.  So names can be any length up to
+//	FileNameMaxLen, and the directory grows (as any other file does)
+//	when entries are added.
+//
+//	In memory, the entries live in a table which is doubled when it
+//	fills up, and are found through a hash table on the name, so
+//	lookups do not slow down as the directory gets large.
 //
 //	The constructor initializes an empty directory of a certain size;
 //	we use ReadFrom/WriteBack to fetch the contents of the directory
 //	from disk, and to write back any modifications back to disk.
 //
-//	Also, this implementation has the restriction that the size
-//	of the directory cannot expand.  In other words, once all the
-//	entries in the directory are used, no more files can be created.
-//	Fixing this is one of the parts to the assignment.
-//
 // Copyright (c) 1992-1993 The Regents of the University of California.
 // All rights reserved.  See copyright.h for copyright notice and limitation 
 // of liability and disclaimer of warranty provisions.
@@ -25,6 +25,34 @@
 #include "filehdr.h"
 #include "directory.h"
 
+// The on-disk form of a directory entry; the name follows it.
+class DirectoryRecord {
+  public:
+    int sector;
+    short nameLen;
+    short isDir;
+};
+
+#define RecordSize(nameLen) \
+    ((int) (divRoundUp(sizeof(DirectoryRecord) + (nameLen), sizeof(int)) \
+	    * sizeof(int)))
+
+//----------------------------------------------------------------------
+// HashName
+// 	Hash a file name (FNV-1a), for the directory's hash table and the
+//	name cache.
+//----------------------------------------------------------------------
+
+static unsigned int
+HashName(char *name)
+{
+    unsigned int hash = 2166136261u;
+
+    for (; *name != '\0'; name++)
+	hash = (hash ^ (unsigned char) *name) * 16777619u;
+    return hash;
+}
+
 //----------------------------------------------------------------------
 // Directory::Directory
 // 	Initialize a directory; initially, the directory is completely
@@ -32,15 +60,16 @@
 //	is all we need, but otherwise, we need to call FetchFrom in order
 //	to initialize it from disk.
 //
-//	"size" is the number of entries in the directory
+//	"size" is the number of entries to make room for at first
 //----------------------------------------------------------------------
 
 Directory::Directory(int size)
 {
-    table = new DirectoryEntry[size];
-    tableSize = size;
-    for (int i = 0; i < tableSize; i++)
-	table[i].inUse = FALSE;
+    table = NULL;
+    tableSize = 0;
+    buckets = NULL;
+    numEntries = 0;
+    Resize(max(size, 1));
 }
 
 //----------------------------------------------------------------------
@@ -50,20 +79,116 @@ Directory::Directory(int size)
 
 Directory::~Directory()
 { 
+    for (int i = 0; i < tableSize; i++)
+	if (table[i].inUse)
+	    delete [] table[i].name;
     delete [] table;
+    delete [] buckets;
+}
+
+//----------------------------------------------------------------------
+// Directory::Resize
+// 	Move the entries into a table of "size" slots, and rebuild the
+//	hash chains and the free list to match.
+//----------------------------------------------------------------------
+
+void
+Directory::Resize(int size)
+{
+    DirectoryEntry *oldTable = table;
+    int i;
+
+    table = new DirectoryEntry[size];
+    for (i = 0; i < size; i++)
+	if (i < tableSize)
+	    table[i] = oldTable[i];
+	else
+	    table[i].inUse = FALSE;
+    delete [] oldTable;
+    tableSize = size;
+
+    delete [] buckets;
+    for (numBuckets = 1; numBuckets < size; numBuckets *= 2)
+	;
+    buckets = new int[numBuckets];
+    for (i = 0; i < numBuckets; i++)
+	buckets[i] = -1;
+
+    freeList = -1;
+    for (i = size - 1; i >= 0; i--) {
+	int *list;
+
+	if (table[i].inUse)
+	    list = &buckets[HashName(table[i].name) & (numBuckets - 1)];
+	else
+	    list = &freeList;
+	table[i].next = *list;
+	*list = i;
+    }
+}
+
+//----------------------------------------------------------------------
+// Directory::Clear
+// 	Empty the directory, before reading it in from disk.
+//----------------------------------------------------------------------
+
+void
+Directory::Clear()
+{
+    for (int i = 0; i < tableSize; i++)
+	if (table[i].inUse) {
+	    delete [] table[i].name;
+	    table[i].inUse = FALSE;
+	}
+    numEntries = 0;
+    Resize(tableSize);
 } 
 
 //----------------------------------------------------------------------
 // Directory::FetchFrom
-// 	Read the contents of the directory from disk.
+// 	Read the contents of the directory from disk.  Return FALSE,
+//	leaving the directory empty, if they don't make sense.
 //
 //	"file" -- file containing the directory contents
 //----------------------------------------------------------------------
 
-void
+bool
 Directory::FetchFrom(OpenFile *file)
 {
-    (void) file->ReadAt((char *)table, tableSize * sizeof(DirectoryEntry), 0);
+    int count, length, position;
+    bool ok = TRUE;
+    char *buf;
+
+    Clear();
+    if (file->ReadAt((char *) &count, sizeof(int), 0) < (int) sizeof(int))
+	return TRUE;		// nothing there yet
+
+    length = file->Length() - sizeof(int);
+    if (count < 0 || count > length / RecordSize(1))
+	return FALSE;
+    if (count > tableSize)
+	Resize(count);
+    buf = new char[length];
+    length = file->ReadAt(buf, length, sizeof(int));
+    for (position = 0; count > 0 && ok; count--) {
+	DirectoryRecord *record = (DirectoryRecord *) (buf + position);
+	char name[FileNameMaxLen + 1];
+
+	ok = (position + RecordSize(0) <= length
+	      && record->nameLen > 0 && record->nameLen <= FileNameMaxLen
+	      && position + RecordSize(record->nameLen) <= length);
+	if (ok) {
+	    bcopy(buf + position + sizeof(DirectoryRecord), name,
+		  record->nameLen);
+	    name[record->nameLen] = '\0';
+	    ok = Add(name, record->sector, record->isDir);
+	    position += RecordSize(record->nameLen);
+	}
+    }
+    delete [] buf;
+    if (!ok)
+	Clear();
+    return ok;
 }
 
 //----------------------------------------------------------------------
@@ -76,7 +201,31 @@ Directory::FetchFrom(OpenFile *file)
 void
 Directory::WriteBack(OpenFile *file)
 {
-    (void) file->WriteAt((char *)table, tableSize * sizeof(DirectoryEntry), 0);
+    int i, length, position;
+    char *buf;
+
+    length = sizeof(int);
+    for (i = 0; i < tableSize; i++)
+	if (table[i].inUse)
+	    length += RecordSize(table[i].nameLen);
+
+    buf = new char[length];
+    bzero(buf, length);
+    *(int *) buf = numEntries;
+    position = sizeof(int);
+    for (i = 0; i < tableSize; i++)
+	if (table[i].inUse) {
+	    DirectoryRecord *record = (DirectoryRecord *) (buf + position);
+
+	    record->sector = table[i].sector;
+	    record->nameLen = table[i].nameLen;
+	    record->isDir = table[i].isDir;
+	    bcopy(table[i].name, buf + position + sizeof(DirectoryRecord),
+		  table[i].nameLen);
+	    position += RecordSize(table[i].nameLen);
+	}
+    (void) file->WriteAt(buf, length, 0);
+    delete [] buf;
 }
 
 //----------------------------------------------------------------------
@@ -90,8 +239,10 @@ Directory::WriteBack(OpenFile *file)
 int
 Directory::FindIndex(char *name)
 {
-    for (int i = 0; i < tableSize; i++)
-        if (table[i].inUse && !strncmp(table[i].name, name, FileNameMaxLen))
+    int i = buckets[HashName(name) & (numBuckets - 1)];
+
+    for (; i != -1; i = table[i].next)
+        if (!strcmp(table[i].name, name))
 	    return i;
     return -1;		// name not in directory
 }
@@ -103,43 +254,58 @@ Directory::FindIndex(char *name)
 //	in the directory.
 //
 //	"name" -- the file name to look up
+//	"isDir" -- if not NULL, set to whether "name" is a directory
 //----------------------------------------------------------------------
 
 int
-Directory::Find(char *name)
+Directory::Find(char *name, bool *isDir)
 {
     int i = FindIndex(name);
 
-    if (i != -1)
-	return table[i].sector;
-    return -1;
+    if (i == -1)
+	return -1;
+    if (isDir != NULL)
+	*isDir = table[i].isDir;
+    return table[i].sector;
 }
 
 //----------------------------------------------------------------------
 // Directory::Add
 // 	Add a file into the directory.  Return TRUE if successful;
 //	return FALSE if the file name is already in the directory, or if
-//	the directory is completely full, and has no more space for
-//	additional file names.
+//	the name is empty or too long.  The directory grows as needed.
 //
 //	"name" -- the name of the file being added
 //	"newSector" -- the disk sector containing the added file's header
+//	"isDir" -- is the file a directory?
 //----------------------------------------------------------------------
 
 bool
-Directory::Add(char *name, int newSector)
+Directory::Add(char *name, int newSector, bool isDir)
 { 
-    if (FindIndex(name) != -1)
+    int len = strlen(name);
+    int i, *chain;
+
+    if (len == 0 || len > FileNameMaxLen || FindIndex(name) != -1)
 	return FALSE;
 
-    for (int i = 0; i < tableSize; i++)
-        if (!table[i].inUse) {
-            table[i].inUse = TRUE;
-            strncpy(table[i].name, name, FileNameMaxLen); 
-            table[i].sector = newSector;
-        return TRUE;
-	}
-    return FALSE;	// no space.  Fix when we have extensible files.
+    if (freeList == -1)
+	Resize(tableSize * 2);
+    i = freeList;
+    freeList = table[i].next;
+
+    table[i].inUse = TRUE;
+    table[i].isDir = isDir;
+    table[i].sector = newSector;
+    table[i].nameLen = len;
+    table[i].name = new char[len + 1];
+    strcpy(table[i].name, name);
+
+    chain = &buckets[HashName(name) & (numBuckets - 1)];
+    table[i].next = *chain;
+    *chain = i;
+    numEntries++;
+    return TRUE;
 }
 
 //----------------------------------------------------------------------
@@ -153,25 +319,51 @@ Directory::Add(char *name, int newSector)
 bool
 Directory::Remove(char *name)
 { 
-    int i = FindIndex(name);
+    int *link = &buckets[HashName(name) & (numBuckets - 1)];
+    int i;
 
+    for (i = *link; i != -1; link = &table[i].next, i = *link)
+	if (!strcmp(table[i].name, name))
+	    break;
     if (i == -1)
 	return FALSE; 		// name not in directory
+
+    *link = table[i].next;
+    delete [] table[i].name;
     table[i].inUse = FALSE;
+    table[i].next = freeList;
+    freeList = i;
+    numEntries--;
     return TRUE;	
 }
 
 //----------------------------------------------------------------------
 // Directory::List
-// 	List all the file names in the directory. 
+// 	List all the file names in the directory, and in the directories
+//	below it, each prefixed with the path to it.
+//
+//	"prefix" -- path of this directory, ending in a PathSeparator
 //----------------------------------------------------------------------
 
 void
-Directory::List()
+Directory::List(char *prefix)
 {
-   for (int i = 0; i < tableSize; i++)
-	if (table[i].inUse)
-	    printf("%s\n", table[i].name);
+    for (int i = 0; i < tableSize; i++)
+	if (table[i].inUse && !table[i].isDir)
+	    printf("%s%s\n", prefix, table[i].name);
+	else if (table[i].inUse) {
+	    char *path = new char[strlen(prefix) + table[i].nameLen + 2];
+	    OpenFile *file = new OpenFile(table[i].sector);
+	    Directory *subdir = new Directory(1);
+
+	    sprintf(path, "%s%s%c", prefix, table[i].name, PathSeparator);
+	    printf("%s\n", path);
+	    if (subdir->FetchFrom(file))
+		subdir->List(path);
+	    delete subdir;
+	    delete file;
+	    delete [] path;
+	}
 }
 
 //----------------------------------------------------------------------
@@ -188,10 +380,97 @@ Directory::Print()
     printf("Directory contents:\n");
     for (int i = 0; i < tableSize; i++)
 	if (table[i].inUse) {
-	    printf("Name: %s, Sector: %d\n", table[i].name, table[i].sector);
+	    printf("Name: %s%s, Sector: %d\n", table[i].name,
+		   table[i].isDir ? "/" : "", table[i].sector);
 	    hdr->FetchFrom(table[i].sector);
 	    hdr->Print();
 	}
     printf("\n");
     delete hdr;
 }
+
+//----------------------------------------------------------------------
+// NameCache::NameCache
+// 	Initialize an empty cache of directory lookups.
+//
+//	"size" is the number of <directory, name> pairs to remember
+//----------------------------------------------------------------------
+
+NameCache::NameCache(int cacheSize)
+{
+    size = cacheSize;
+    table = new NameCacheEntry[size];
+    for (int i = 0; i < size; i++) {
+	table[i].dirSector = -1;
+	table[i].name = NULL;
+    }
+}
+
+NameCache::~NameCache()
+{
+    for (int i = 0; i < size; i++)
+	delete [] table[i].name;
+    delete [] table;
+}
+
+//----------------------------------------------------------------------
+// NameCache::Index
+// 	Return the slot for "name" in the directory at "dirSector".
+//----------------------------------------------------------------------
+
+int
+NameCache::Index(int dirSector, char *name)
+{
+    return (HashName(name) ^ ((unsigned) dirSector * 2654435761u)) % size;
+}
+
+//----------------------------------------------------------------------
+// NameCache::Find
+// 	Return the header sector of "name" in the directory at "dirSector",
+//	and whether it is a directory, or -1 if we don't remember it.
+//----------------------------------------------------------------------
+
+int
+NameCache::Find(int dirSector, char *name, bool *isDir)
+{
+    NameCacheEntry *e = &table[Index(dirSector, name)];
+
+    if (e->dirSector != dirSector || strcmp(e->name, name))
+	return -1;
+    *isDir = e->isDir;
+    return e->sector;
+}
+
+//----------------------------------------------------------------------
+// NameCache::Enter
+// 	Remember that "name" in the directory at "dirSector" has its
+//	header at "sector".
+//----------------------------------------------------------------------
+
+void
+NameCache::Enter(int dirSector, char *name, int sector, bool isDir)
+{
+    NameCacheEntry *e = &table[Index(dirSector, name)];
+
+    delete [] e->name;
+    e->name = new char[strlen(name) + 1];
+    strcpy(e->name, name);
+    e->dirSector = dirSector;
+    e->sector = sector;
+    e->isDir = isDir;
+}
+
+//----------------------------------------------------------------------
+// NameCache::Forget
+// 	Drop what we know about "name" in the directory at "dirSector",
+//	because it has been removed.
+//----------------------------------------------------------------------
+
+void
+NameCache::Forget(int dirSector, char *name)
+{
+    NameCacheEntry *e = &table[Index(dirSector, name)];
+
+    if (e->dirSector == dirSector && !strcmp(e->name, name))
+	e->dirSector = -1;
+}
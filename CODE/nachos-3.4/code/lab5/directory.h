@@ -4,7 +4,9 @@
 //      A directory is a table of pairs: <file name, sector #>,
 //	giving the name of each file in the directory, and 
 //	where to find its file header (the data structure describing
-//	where to find the file's data blocks) on disk.
+//	where to find the file's data blocks) on disk.  An entry may
+//	itself name a directory, so directories form a tree rooted at
+//	the file system's root directory.
 //
 //      We assume mutual exclusion is provided by the caller.
 //
@@ -19,8 +21,9 @@
 
 #include "openfile.h"
 
-#define FileNameMaxLen        9    // for simplicity, we assume
-// file names are <= 9 characters long
+#define FileNameMaxLen        255    // longest name of a single file
+// or directory (not of a whole path)
+#define PathSeparator        '/'
 
 // The following class defines a "directory entry", representing a file
 // in the directory.  Each entry gives the name of the file, and where
@@ -32,17 +35,23 @@
 class DirectoryEntry {
 public:
     bool inUse;                // Is this directory entry in use?
+    bool isDir;                // Does it name a directory?
     int sector;                // Location on disk to find the
     //   FileHeader for this file
-    char name[FileNameMaxLen + 1];    // Text name for file, with +1 for
-    // the trailing '\0'
+    int nameLen;            // Length of name, not counting the '\0'
+    char *name;                // Text name for file
+    int next;                // Next entry in the same hash chain,
+    // or in the free list; -1 ends the list
 };
 
 // The following class defines a UNIX-like "directory".  Each entry in
 // the directory describes a file, and where to find it on disk.
 //
 // The directory data structure can be stored in memory, or on disk.
-// When it is on disk, it is stored as a regular Nachos file.
+// When it is on disk, it is stored as a regular Nachos file, holding
+// a count of entries followed by variable-length records, one per file.
+// In memory, the entries are kept in a table that grows as needed,
+// indexed by a hash table on the file name.
 //
 // The constructor initializes a directory structure in memory; the
 // FetchFrom/WriteBack operations shuffle the directory information
@@ -51,22 +60,26 @@ public:
 class Directory {
 public:
     Directory(int size);        // Initialize an empty directory
-    // with space for "size" files
+    // with room for "size" files to start
     ~Directory();            // De-allocate the directory
 
-    void FetchFrom(OpenFile *file);    // Init directory contents from disk
+    bool FetchFrom(OpenFile *file);    // Init directory contents from disk
     void WriteBack(OpenFile *file);    // Write modifications to
     // directory contents back to disk
 
-    int Find(char *name);        // Find the sector number of the
+    int Find(char *name, bool *isDir = NULL);
+    // Find the sector number of the
     // FileHeader for file: "name"
 
-    bool Add(char *name, int newSector);  // Add a file name into the directory
+    bool Add(char *name, int newSector, bool isDir = FALSE);
+    // Add a file name into the directory
 
     bool Remove(char *name);        // Remove a file from the directory
 
-    void List();            // Print the names of all the files
-    //  in the directory
+    bool IsEmpty() { return numEntries == 0; }
+
+    void List(char *prefix);        // Print the names of all the files
+    //  in the directory, and below it
     void Print();            // Verbose print of the contents
     //  of the directory -- all the file
     //  names and their contents.
@@ -75,9 +88,52 @@ private:
     int tableSize;            // Number of directory entries
     DirectoryEntry *table;        // Table of pairs:
     // <file name, file header location>
+    int numEntries;            // Number of entries in use
+    int freeList;            // First unused entry, or -1
+
+    int numBuckets;            // Size of hash table (a power of 2)
+    int *buckets;            // First entry in each hash chain
 
     int FindIndex(char *name);        // Find the index into the directory
     //  table corresponding to "name"
+    void Clear();            // Forget all the entries
+    void Resize(int size);        // Grow the table to "size" entries,
+    // and rebuild the hash table
+};
+
+// The following class caches the results of looking names up in
+// directories, so that following a path does not have to read every
+// directory along the way.  Each entry maps <directory, name> to the
+// sector of the file's header; the cache is direct-mapped, so a new
+// entry simply replaces whatever was in its slot.
+
+class NameCacheEntry {
+public:
+    int dirSector;            // Header sector of the directory,
+    // or -1 if the entry is unused
+    int sector;                // Header sector of the file
+    bool isDir;
+    char *name;
+};
+
+class NameCache {
+public:
+    NameCache(int size);        // Initialize an empty cache
+    ~NameCache();
+
+    int Find(int dirSector, char *name, bool *isDir);
+    // Return the sector for "name" in
+    // directory "dirSector", or -1 if
+    // it is not cached
+    void Enter(int dirSector, char *name, int sector, bool isDir);
+    void Forget(int dirSector, char *name);
+    // Drop the entry for a removed file
+
+private:
+    int size;
+    NameCacheEntry *table;
+
+    int Index(int dirSector, char *name);
 };
 
 #endif // DIRECTORY_H
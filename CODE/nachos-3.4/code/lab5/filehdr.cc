@@ -1,17 +1,20 @@
-// filehdr.cc 
+// filehdr.cc
 //	Routines for managing the disk file header (in UNIX, this
 //	would be called the i-node).
 //
-//	The file header is used to locate where on disk the 
-//	file's data is stored.  We implement this as a fixed size
-//	table of pointers -- each entry in the table points to the 
-//	disk sector containing that portion of the file data
-//	(in other words, there are no indirect or doubly indirect 
-//	blocks). The table size is chosen so that the file header
-//	will be just big enough to fit in one disk sector, 
+//	The file header is used to locate where on disk the
+//	file's data is stored.  As in UNIX, the header itself points
+//	directly at the first NumDirect data sectors; after that, a
+//	single indirect block points at the next NumPointers data
+//	sectors, a double indirect block at NumPointers more indirect
+//	blocks, and a triple indirect block at NumPointers double
+//	indirect blocks.  So finding any sector of a file takes at most
+//	three reads of indirect blocks, and those are cached in memory
+//	once read.  Opening a file reads only the header; indirect blocks
+//	are read when first used, and written back only if they changed.
 //
-//      Unlike in a real system, we do not keep track of file permissions, 
-//	ownership, last modification date, etc., in the file header. 
+//      Unlike in a real system, we do not keep track of file permissions,
+//	ownership, last modification date, etc., in the file header.
 //
 //	A file header can be initialized in two ways:
 //	   for a new file, by modifying the in-memory data structure
@@ -19,7 +22,7 @@
 //	   for a file already on disk, by reading the file header from disk
 //
 // Copyright (c) 1992-1993 The Regents of the University of California.
-// All rights reserved.  See copyright.h for copyright notice and limitation 
+// All rights reserved.  See copyright.h for copyright notice and limitation
 // of liability and disclaimer of warranty provisions.
 
 #include "copyright.h"
@@ -27,6 +30,120 @@
 #include "system.h"
 #include "filehdr.h"
 
+//----------------------------------------------------------------------
+// IndirectBlocks
+// 	Return how many indirect blocks a file of "sectors" data sectors
+//	needs.  A tree of depth d holding "count" data sectors has
+//	divRoundUp(count, NumPointers^k) blocks at each of its d levels.
+//----------------------------------------------------------------------
+
+static int
+IndirectBlocks(int sectors)
+{
+    int blocks = 0;
+    int span = NumPointers;
+
+    sectors -= NumDirect;
+    for (int level = 0; level < NumLevels && sectors > 0; level++) {
+        int count = min(sectors, span);
+
+        for (int k = NumPointers; k <= span; k *= NumPointers)
+            blocks += divRoundUp(count, k);
+        sectors -= span;
+        span *= NumPointers;
+    }
+    return blocks;
+}
+
+//----------------------------------------------------------------------
+// IndirectBlock::IndirectBlock
+// 	Bring an indirect block into memory.
+//
+//	"sector" is where the block lives on disk
+//	"fetch" is whether to read it in; if not, it is a new block, and
+//	    all its pointers are unused
+//	"leaf" is whether it points at data sectors, rather than at
+//	    further indirect blocks
+//----------------------------------------------------------------------
+
+IndirectBlock::IndirectBlock(int blockSector, bool fetch, bool leaf) {
+    int i;
+
+    sector = blockSector;
+    dirty = !fetch;            // a new block must go to disk
+    if (fetch)
+        bufferCache->ReadSector(sector, (char *) pointers);
+    else
+        for (i = 0; i < NumPointers; i++)
+            pointers[i] = -1;
+
+    children = NULL;
+    if (!leaf) {
+        children = new IndirectBlock *[NumPointers];
+        for (i = 0; i < NumPointers; i++)
+            children[i] = NULL;
+    }
+}
+
+IndirectBlock::~IndirectBlock() {
+    if (children != NULL) {
+        for (int i = 0; i < NumPointers; i++)
+            delete children[i];
+        delete[] children;
+    }
+}
+
+//----------------------------------------------------------------------
+// IndirectBlock::WriteBack
+// 	Write this block, and the blocks below it that are in memory,
+//	back to disk -- those of them that have changed.
+//----------------------------------------------------------------------
+
+void
+IndirectBlock::WriteBack() {
+    if (dirty) {
+        bufferCache->WriteSector(sector, (char *) pointers);
+        dirty = FALSE;
+    }
+    if (children != NULL)
+        for (int i = 0; i < NumPointers; i++)
+            if (children[i] != NULL)
+                children[i]->WriteBack();
+}
+
+//----------------------------------------------------------------------
+// FileHeader::FileHeader
+// 	Initialize an empty file header.  Fill it in with Allocate or
+//	FetchFrom.
+//----------------------------------------------------------------------
+
+FileHeader::FileHeader() {
+    numBytes = numSectors = 0;
+    dirty = FALSE;
+    nextGoal = -1;
+    for (int i = 0; i < NumLevels; i++) {
+        indirectSectors[i] = -1;
+        indirect[i] = NULL;
+    }
+}
+
+FileHeader::~FileHeader() {
+    ForgetBlocks();
+}
+
+//----------------------------------------------------------------------
+// FileHeader::ForgetBlocks
+// 	Throw away the indirect blocks we have read in.
+//----------------------------------------------------------------------
+
+void
+FileHeader::ForgetBlocks() {
+    for (int i = 0; i < NumLevels; i++) {
+        delete indirect[i];
+        indirect[i] = NULL;
+    }
+}
+
 //----------------------------------------------------------------------
 // FileHeader::Allocate
 // 	Initialize a fresh file header for a newly created file.
@@ -35,97 +152,189 @@
 //	the new file.
 //
 //	"freeMap" is the bit map of free disk sectors
-//	"fileSize" is the bit map of free disk sectors
+//	"fileSize" is the number of bytes in the new file
+//	"goal" is where the data should preferably start, or -1
 //----------------------------------------------------------------------
 
 bool
-FileHeader::Allocate(BitMap *freeMap, int fileSize) {
-    numBytes = fileSize;
-    numSectors = divRoundUp(fileSize, SectorSize);
-
-    int directSectors = numSectors;
-    if (numSectors > NumDirect - 1) directSectors = NumDirect - 1;
-
-    if (freeMap->NumClear() < directSectors)
-        return FALSE;        // not enough space
-    for (int i = 0; i < directSectors; i++)
-        dataSectors[i] = freeMap->Find();
-
-    if (numSectors > NumDirect - 1) {
-        printf("Now allocate numSectors > NumDirect - 1\n");
-        int indirectSector = freeMap->Find();
-        if (indirectSector == -1) {
-            return FALSE;
-        } else {
-            indirect = new FileHeader;
-            int remainFileSize = fileSize - (NumDirect - 1) * SectorSize;
-            if (!indirect->Allocate(freeMap, remainFileSize))
-                return FALSE;
-            dataSectors[NumDirect - 1] = indirectSector;
-        }
-    } else {
-        printf("Now allocate numSectors < NumDirect - 1\n");
-        indirect = NULL;
-        dataSectors[NumDirect - 1] = -1;
-    }
+FileHeader::Allocate(BitMap *freeMap, int fileSize, int goal) {
+    int i;
 
-    return TRUE;
+    ForgetBlocks();
+    numBytes = numSectors = 0;
+    for (i = 0; i < NumDirect; i++)
+        dataSectors[i] = -1;
+    for (i = 0; i < NumLevels; i++)
+        indirectSectors[i] = -1;
+    dirty = TRUE;
+    nextGoal = goal;
+    return Extend(freeMap, fileSize) >= 0;
 }
 
 //----------------------------------------------------------------------
 // FileHeader::Deallocate
-// 	De-allocate all the space allocated for data blocks for this file.
+// 	De-allocate all the space allocated for data blocks for this file,
+//	and for the indirect blocks pointing at them.
 //
 //	"freeMap" is the bit map of free disk sectors
 //----------------------------------------------------------------------
 
 void
 FileHeader::Deallocate(BitMap *freeMap) {
-    if (indirect != NULL) indirect->Deallocate(freeMap);
-    int directSectors = numSectors;
-    if (numSectors > NumDirect - 1) directSectors = NumDirect - 1;
-    for (int i = 0; i < directSectors; i++) {
-        ASSERT(freeMap->Test((int) dataSectors[i]));  // ought to be marked!
-        freeMap->Clear((int) dataSectors[i]);
+    int i;
+
+    for (i = 0; i < numSectors; i++) {
+        int sector = *Slot(i, NULL, NULL);
+
+        ASSERT(freeMap->Test(sector));  // ought to be marked!
+        freeMap->Clear(sector);
+    }
+    for (i = 0; i < NumLevels; i++)
+        FreeBlock(indirectSectors[i], &indirect[i], i, freeMap);
+}
+
+//----------------------------------------------------------------------
+// FileHeader::FreeBlock
+// 	Give back the sectors of an indirect block and of the indirect
+//	blocks below it.  The data sectors are freed separately.
+//
+//	"depth" is how many levels of indirect blocks are below this one
+//----------------------------------------------------------------------
+
+void
+FileHeader::FreeBlock(int sector, IndirectBlock **block, int depth,
+                      BitMap *freeMap) {
+    if (sector == -1)
+        return;
+    LoadBlock(&sector, block, depth == 0, NULL, NULL);
+    if (depth > 0)
+        for (int i = 0; i < NumPointers; i++)
+            FreeBlock((*block)->pointers[i], &(*block)->children[i],
+                      depth - 1, freeMap);
+    ASSERT(freeMap->Test(sector));
+    freeMap->Clear(sector);
+}
+
+//----------------------------------------------------------------------
+// FileHeader::LoadBlock
+// 	Make sure the indirect block at "*sector" is in memory, at
+//	"*block".  If the block doesn't exist yet and "freeMap" is given,
+//	allocate a sector for it, in line with the data sectors around
+//	it (see Extend).  Return FALSE if there is no block.
+//
+//	"leaf" is whether the block points at data sectors
+//	"owner" is the dirty flag of the header or block holding "*sector"
+//----------------------------------------------------------------------
+
+bool
+FileHeader::LoadBlock(int *sector, IndirectBlock **block, bool leaf,
+                      BitMap *freeMap, bool *owner) {
+    if (*block != NULL)
+        return TRUE;
+    if (*sector != -1) {
+        DEBUG('f', "Reading indirect block %d.\n", *sector);
+        *block = new IndirectBlock(*sector, TRUE, leaf);
+        return TRUE;
+    }
+    if (freeMap == NULL || (*sector = freeMap->Find(nextGoal)) == -1)
+        return FALSE;
+    nextGoal = *sector + 1;
+    *block = new IndirectBlock(*sector, FALSE, leaf);
+    *owner = TRUE;
+    return TRUE;
+}
+
+//----------------------------------------------------------------------
+// FileHeader::Slot
+// 	Return where the sector number of the "index"th data block of the
+//	file is kept -- in the header, or in an indirect block -- reading
+//	in indirect blocks on the way.  If "freeMap" is given, missing
+//	indirect blocks are allocated; otherwise they must exist.
+//
+//	"owner", if not NULL, is set to the dirty flag of the header or
+//	block holding the slot, for callers that change it
+//----------------------------------------------------------------------
+
+int *
+FileHeader::Slot(int index, BitMap *freeMap, bool **owner) {
+    int level, span;
+    int *sector;
+    IndirectBlock **block;
+    bool *holder = &dirty;
+
+    if (owner != NULL)
+        *owner = holder;
+    if (index < NumDirect)
+        return &dataSectors[index];
+
+    // find the tree that covers the block, and the block's index in it
+    index -= NumDirect;
+    for (level = 0, span = NumPointers; index >= span; level++) {
+        index -= span;
+        span *= NumPointers;
+    }
+    ASSERT(level < NumLevels);
+
+    // walk down the tree, one indirect block per level
+    sector = &indirectSectors[level];
+    block = &indirect[level];
+    for (;;) {
+        span /= NumPointers;
+        if (!LoadBlock(sector, block, span == 1, freeMap, holder))
+            return NULL;
+        holder = &(*block)->dirty;
+        if (owner != NULL)
+            *owner = holder;
+        if (span == 1)
+            return &(*block)->pointers[index];
+        sector = &(*block)->pointers[index / span];
+        block = &(*block)->children[index / span];
+        index %= span;
     }
 }
 
 //----------------------------------------------------------------------
 // FileHeader::FetchFrom
-// 	Fetch contents of file header from disk. 
+// 	Fetch contents of file header from disk.  Indirect blocks are
+//	read later, when they are needed.
 //
 //	"sector" is the disk sector containing the file header
 //----------------------------------------------------------------------
 
 void
 FileHeader::FetchFrom(int sector) {
-	// print the sector to fetch from for debug easily
-	printf("Fetch from sector %d.\n", sector);
-    synchDisk->ReadSector(sector, (char *) this);
-    // read from indirect fileheader
-    if (dataSectors[NumDirect-1] != -1) {
-        indirect = new FileHeader;
-        indirect->FetchFrom(dataSectors[NumDirect-1]);
-    }
+    char buf[SectorSize];
+
+    DEBUG('f', "Reading file header %d.\n", sector);
+    ForgetBlocks();
+    bufferCache->ReadSector(sector, buf);
+    bcopy(buf, (char *) this, FileHeaderSize);
+    dirty = FALSE;
 }
 
 //----------------------------------------------------------------------
 // FileHeader::WriteBack
-// 	Write the modified contents of the file header back to disk. 
+// 	Write the modified contents of the file header back to disk,
+//	along with the indirect blocks that have changed.  Nothing is
+//	written if nothing changed.
 //
 //	"sector" is the disk sector to contain the file header
 //----------------------------------------------------------------------
 
 void
 FileHeader::WriteBack(int sector) {
-    // write back to the indirect fileheader
-    if (indirect != NULL) {
-        // print the sector to write back for debug easily
-        printf("writing back indirect sector %d. \n", dataSectors[NumDirect-1]);
-        indirect->WriteBack(dataSectors[NumDirect-1]);
-    }
-    printf("writing back direct sector %d. \n", sector);
-    synchDisk->WriteSector(sector, (char *) this);
+    char buf[SectorSize];
+
+    for (int i = 0; i < NumLevels; i++)
+        if (indirect[i] != NULL)
+            indirect[i]->WriteBack();
+    if (!dirty)
+        return;
+    DEBUG('f', "Writing file header %d.\n", sector);
+    bzero(buf, SectorSize);
+    bcopy((char *) this, buf, FileHeaderSize);
+    bufferCache->WriteSector(sector, buf);
+    dirty = FALSE;
 }
 
 //----------------------------------------------------------------------
@@ -140,11 +349,10 @@ FileHeader::WriteBack(int sector) {
 
 int
 FileHeader::ByteToSector(int offset) {
-    int directSector = offset / SectorSize;
-    if (directSector >= NumDirect-1) return indirect->ByteToSector(offset - (NumDirect-1)*SectorSize);
-	// print this for debuging easily, but there are too much these infos, so I note it
-//	printf("ByteToSector is %d, \n", dataSectors[offset / SectorSize]);
-    return(dataSectors[directSector]);
+    int *slot = Slot(offset / SectorSize, NULL, NULL);
+
+    ASSERT(slot != NULL);
+    return *slot;
 }
 
 //----------------------------------------------------------------------
@@ -165,24 +373,19 @@ FileHeader::FileLength() {
 
 void
 FileHeader::Print() {
-    int directSector, directBytes;
-    if (numSectors > NumDirect-1) {
-        directSector = NumDirect-1;
-        directBytes = directSector * SectorSize;
-    } else {
-        directSector = numSectors;
-        directBytes = numBytes;
-    }
     int i, j, k;
     char *data = new char[SectorSize];
 
     printf("FileHeader contents.  File size: %d.  File blocks:\n", numBytes);
-    for (i = 0; i < directSector; i++)
-        printf("%d ", dataSectors[i]);
+    for (i = 0; i < numSectors; i++)
+        printf("%d ", ByteToSector(i * SectorSize));
+    printf("\nIndirect blocks:");
+    for (i = 0; i < NumLevels; i++)
+        printf(" %d", indirectSectors[i]);
     printf("\nFile contents:\n");
-    for (i = k = 0; i < directSector; i++) {
-        synchDisk->ReadSector(dataSectors[i], data);
-        for (j = 0; (j < SectorSize) && (k < directBytes); j++, k++) {
+    for (i = k = 0; i < numSectors; i++) {
+        bufferCache->ReadSector(ByteToSector(i * SectorSize), data);
+        for (j = 0; (j < SectorSize) && (k < numBytes); j++, k++) {
             if ('\040' <= data[j] && data[j] <= '\176')   // isprint(data[j])
                 printf("%c", data[j]);
             else
@@ -191,64 +394,55 @@ FileHeader::Print() {
         printf("\n");
     }
     delete [] data;
-    if (indirect != NULL) {
-        printf("Now print indirect.\n");
-        indirect->Print();
-    }
 }
 
-int FileHeader::Extend(int newFileSize) {
+//----------------------------------------------------------------------
+// FileHeader::Extend
+// 	Grow the file to "newFileSize" bytes.  Returns 0 if nothing changed,
+//	1 if only the length changed, 2 if sectors were taken from
+//	"freeMap", and -1 if there was no room for the new sectors.
+//
+//	Each new sector is taken as close after the one before it as
+//	possible (indirect blocks included, just ahead of the sectors they
+//	point at), so the file's data lies in rotational order and a
+//	sequential read is served mostly from the disk's track buffer.
+//
+//	"freeMap" is the file system's in-memory bit map of free sectors
+//----------------------------------------------------------------------
+
+int FileHeader::Extend(BitMap *freeMap, int newFileSize) {
     // nothing needs to change
     if (newFileSize <= numBytes)
         return 0;
+    if (newFileSize > MaxFileSize)
+        return -1;
     // change fileSize but don't change numSectors
     int newNumSectors = divRoundUp(newFileSize, SectorSize);
     if (newNumSectors == numSectors) {
         numBytes = newFileSize;
+        dirty = TRUE;
         return 1;
     }
 
-    // change fileSize and numSectors
-    int appendSectorsNum = newNumSectors - numSectors;
-    // bitmap is located in 0 sector
-    OpenFile *bitmapFile = new OpenFile(0);
-    BitMap *freeMap = new BitMap(NumSectors);
-    freeMap->FetchFrom(bitmapFile);
-    // if no more space to allocate new sectors, just return -1
-    if (freeMap->NumClear() < appendSectorsNum)
+    // change fileSize and numSectors; make sure there is room for the
+    // data sectors and any new indirect blocks before taking any
+    int needed = newNumSectors - numSectors
+                 + IndirectBlocks(newNumSectors) - IndirectBlocks(numSectors);
+    if (freeMap->NumClear() < needed)
         return -1;
-    // if indirect is not null, we should just extend indirect fileheader
-    if (indirect != NULL) {
-        int remainFileSize = newFileSize - (NumDirect - 1) * SectorSize;
-        int indirectSector = dataSectors[NumDirect - 1];
-        indirect->FetchFrom(indirectSector);
-        indirect->Extend(remainFileSize);
-        indirect->WriteBack(indirectSector);
-    } else {
-        // similar to Allocate() function
-        int directSectors = newNumSectors;
-        if (newNumSectors > NumDirect - 1) directSectors = NumDirect - 1;
-        for (int i = numSectors; i < directSectors; i++)
-            dataSectors[i] = freeMap->Find();
-
-        if (newNumSectors > NumDirect - 1) {
-            int indirectSector = freeMap->Find();
-            if (indirectSector == -1) {
-                return -1;
-            } else {
-                indirect = new FileHeader;
-                dataSectors[NumDirect - 1] = indirectSector;
-                int remainFileSize = newFileSize - directSectors * SectorSize;
-                if (!indirect->Allocate(freeMap, remainFileSize))
-                    return -1;
-            }
-        } else {
-            indirect = NULL;
-            dataSectors[NumDirect - 1] = -1;
-        }
+    if (numSectors > 0)
+        nextGoal = ByteToSector((numSectors - 1) * SectorSize) + 1;
+    for (int i = numSectors; i < newNumSectors; i++) {
+        bool *owner;
+        int *slot = Slot(i, freeMap, &owner);
+
+        ASSERT(slot != NULL);
+        *slot = freeMap->Find(nextGoal);
+        nextGoal = *slot + 1;
+        *owner = TRUE;
     }
+    dirty = TRUE;
     numBytes = newFileSize;
     numSectors = newNumSectors;
-    freeMap->WriteBack(bitmapFile);
     return 2;
 }
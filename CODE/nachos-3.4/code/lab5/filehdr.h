@@ -1,12 +1,12 @@
-// filehdr.h 
-//	Data structures for managing a disk file header.  
+// filehdr.h
+//	Data structures for managing a disk file header.
 //
 //	A file header describes where on disk to find the data in a file,
 //	along with other information about the file (for instance, its
 //	length, owner, etc.)
 //
 // Copyright (c) 1992-1993 The Regents of the University of California.
-// All rights reserved.  See copyright.h for copyright notice and limitation 
+// All rights reserved.  See copyright.h for copyright notice and limitation
 // of liability and disclaimer of warranty provisions.
 
 #include "copyright.h"
@@ -17,29 +17,63 @@
 #include "disk.h"
 #include "bitmap.h"
 
-#define NumDirect    ((SectorSize - 3 * sizeof(int)) / sizeof(int))
-#define MaxFileSize    (NumDirect * SectorSize)
+#define NumPointers    ((int) (SectorSize / sizeof(int)))
+// sector numbers in an indirect block
+#define NumLevels    3        // single, double and triple indirect
+#define NumDirect    (NumPointers - 2 - NumLevels)
+#define MaxFileSize    ((NumDirect + NumPointers + NumPointers * NumPointers \
+            + NumPointers * NumPointers * NumPointers) * SectorSize)
 
-// The following class defines the Nachos "file header" (in UNIX terms,  
+// The following class defines an indirect block, as it is kept in
+// memory: a sector full of sector numbers, and -- for a block that
+// points at further indirect blocks -- those of the blocks below it
+// that have been read in so far.
+
+class IndirectBlock {
+public:
+    IndirectBlock(int sector, bool fetch, bool leaf);
+    // Read in (if "fetch") or start
+    // an empty indirect block
+    ~IndirectBlock();            // Also frees the blocks below
+
+    void WriteBack();            // Write this block, and those below
+    // it, back to disk if they changed
+
+    int sector;                // Where the block lives on disk
+    int pointers[NumPointers];        // Sector numbers, -1 if unused
+    IndirectBlock **children;        // Blocks below, NULL until read in;
+    // NULL altogether for the bottom level
+    bool dirty;                // Changed since read in or written?
+};
+
+// The following class defines the Nachos "file header" (in UNIX terms,
 // the "i-node"), describing where on disk to find all of the data in the file.
-// The file header is organized as a simple table of pointers to
-// data blocks. 
+// As in UNIX, the header holds the sector numbers of the first
+// NumDirect data blocks, then the sectors of a single, a double and a
+// triple indirect block for the rest of the file.  Indirect blocks are
+// only read in when a part of the file they cover is first used, and
+// stay in memory while the header does.  The header and each indirect
+// block remember whether they have changed, so WriteBack only writes
+// the sectors that need it.
 //
 // The file header data structure can be stored in memory or on disk.
 // When it is on disk, it is stored in a single sector -- this means
-// that we assume the size of this data structure to be the same
-// as one disk sector.  Without indirect addressing, this
-// limits the maximum file length to just under 4K bytes.
+// that we assume the size of the on-disk part of this data structure
+// to be the same as one disk sector.
 //
-// There is no constructor; rather the file header can be initialized
-// by allocating blocks for the file (if it is a new file), or by
-// reading it from disk.
+// A file header can be initialized by allocating blocks for the file
+// (if it is a new file), or by reading it from disk.
 
 class FileHeader {
 public:
-    bool Allocate(BitMap *bitMap, int fileSize);// Initialize a file header, 
+    FileHeader();            // An empty header
+    ~FileHeader();            // Frees the cached indirect blocks
+
+    bool Allocate(BitMap *bitMap, int fileSize, int goal = -1);
+    // Initialize a file header,
     //  including allocating space
-    //  on disk for the file data
+    //  on disk for the file data,
+    //  starting near "goal" if given
     void Deallocate(BitMap *bitMap);        // De-allocate this file's
     //  data blocks
 
@@ -56,14 +90,40 @@ public:
 
     void Print();            // Print the contents of the file.
 
-    int Extend(int newFileSize);
+    int Extend(BitMap *freeMap, int newFileSize);
+    // Grow the file to "newFileSize" bytes,
+    // taking sectors from "freeMap"
 
 private:
+    // This much is stored on disk
     int numBytes;            // Number of bytes in the file
     int numSectors;            // Number of data sectors in the file
     int dataSectors[NumDirect];        // Disk sector numbers for each data
-    // block in the file
-    FileHeader *indirect;
+    // block at the start of the file
+    int indirectSectors[NumLevels];    // Single, double and triple
+    // indirect blocks, -1 if unused
+
+    // This is only in memory
+    IndirectBlock *indirect[NumLevels];    // Indirect blocks read in so far
+    bool dirty;                // Header changed since read or written?
+    int nextGoal;            // Where the next sector allocated for
+    // the file should preferably go, or -1
+
+    int *Slot(int index, BitMap *freeMap, bool **owner);
+    // Where the sector number for data
+    // block "index" is kept
+    bool LoadBlock(int *sector, IndirectBlock **block, bool leaf,
+                   BitMap *freeMap, bool *owner);
+    // Read in an indirect block, or
+    // allocate it if "freeMap" is given
+    void FreeBlock(int sector, IndirectBlock **block, int depth,
+                   BitMap *freeMap);
+    // Free an indirect block and those
+    // below it
+    void ForgetBlocks();        // Drop the cached indirect blocks
 };
 
+#define FileHeaderSize    ((2 + NumDirect + NumLevels) * (int) sizeof(int))
+// Bytes of a FileHeader kept on disk
+
 #endif // FILEHDR_H
@@ -11,33 +11,46 @@
 //
 // 	The file system consists of several data structures:
 //	   A bitmap of free disk sectors (cf. bitmap.h)
-//	   A directory of file names and file headers
+//	   A tree of directories of file names and file headers
 //
 //      Both the bitmap and the directory are represented as normal
 //	files.  Their file headers are located in specific sectors
-//	(sector 0 and sector 1), so that the file system can find them 
-//	on bootup.
+//	(sector 1 and sector 2, after the superblock in sector 0), so
+//	that the file system can find them on bootup.  The directory in
+//	sector 2 is the root; files in other directories are named by
+//	paths, such as "usr/bin/ls".
 //
 //	The file system assumes that the bitmap and directory files are
 //	kept "open" continuously while Nachos is running.
 //
-//	For those operations (such as Create, Remove) that modify the
-//	directory and/or bitmap, if the operation succeeds, the changes
-//	are written immediately back to disk (the two files are kept
-//	open during all this time).  If the operation fails, and we have
-//	modified part of the directory and/or bitmap, we simply discard
-//	the changed version, without writing it back to disk.
+//	The bitmap and directory are also read into memory once, when the
+//	file system is mounted, and kept there.  Operations (such as
+//	Create, Remove) that modify them change the in-memory copies,
+//	which are written back to their files before the operation is
+//	done.  If an operation fails partway, it undoes whatever it
+//	changed in the in-memory copies.
+//
+//	All metadata written -- the bitmap, directories, file headers --
+//	goes through a journal (cf. journal.h): the changes made by a
+//	batch of operations -- MetadataBatch changes, or up to a Sync --
+//	are committed to it together, in one sequential write, and reach
+//	their home sectors later, in the background.  Until then, writing
+//	the bitmap and directory back only updates the buffer cache.
+//
+//	Space is handed out with the disk's track buffer in mind: a file's
+//	header and data go in one track where they fit, in rotational
+//	order, near the directory holding the file (see AllocateHeader).
 //
 // 	Our implementation at this point has the following restrictions:
 //
 //	   there is no synchronization for concurrent accesses
-//	   files have a fixed size, set when the file is created
-//	   files cannot be bigger than about 3KB in size
-//	   there is no hierarchical directory structure, and only a limited
-//	     number of files can be added to the system
-//	   there is no attempt to make the system robust to failures
-//	    (if Nachos exits in the middle of an operation that modifies
-//	    the file system, it may corrupt the disk)
+//	   a file grows as it is written past its end (cf.
+//	    FileHeader::Extend), but only while its data fits in
+//	    NumExtents runs of free sectors
+//	   only metadata is journaled: if Nachos exits in the middle
+//	    of things, the file system comes back as of the last commit,
+//	    but file data written since the last Sync may be lost, or
+//	    only partly there
 //
 // Copyright (c) 1992-1993 The Regents of the University of California.
 // All rights reserved.  See copyright.h for copyright notice and limitation 
@@ -50,19 +63,35 @@
 #include "directory.h"
 #include "filehdr.h"
 #include "filesys.h"
+#include "journal.h"
+#include "system.h"
+
+// Sectors containing the superblock, and the file headers for the
+// bitmap of free sectors, and the directory of files.  These are placed
+// in well-known sectors, so that they can be located on boot-up.
+#define SuperBlockSector    0
+#define FreeMapSector        1
+#define DirectorySector    2
+
+#define FileSystemMagic    0x4e465332    // "NFS2"
+
+// Initial file sizes for the bitmap and directory; a directory file
+// grows as entries are added to it.
+#define FreeMapFileSize(sectors) \
+    (divRoundUp(sectors, BitsInWord) * (int) sizeof(unsigned))
+#define NumDirEntries        10
+#define DirectoryFileSize    SectorSize
 
-// Sectors containing the file headers for the bitmap of free sectors,
-// and the directory of files.  These file headers are placed in well-known 
-// sectors, so that they can be located on boot-up.
-#define FreeMapSector        0
-#define DirectorySector    1
+// Tracks in an allocation group.  Each directory keeps its files in
+// one group, so they stay near each other on disk.
+#define GroupTracks    4
 
-// Initial file sizes for the bitmap and directory; until the file system
-// supports extensible files, the directory size sets the maximum number 
-// of files that can be loaded onto the disk.
-#define FreeMapFileSize    (NumSectors / BitsInByte)
-#define NumDirEntries        10
-#define DirectoryFileSize    (sizeof(DirectoryEntry) * NumDirEntries)
+// Number of <directory, name> lookups to remember.
+#define NameCacheSize    64
+
+// Number of changes to the bitmap and directory we let pile up in memory
+// before writing them back to disk.
+#define MetadataBatch    8
 
 //----------------------------------------------------------------------
 // FileSystem::FileSystem
@@ -74,28 +103,69 @@
 //	If format = FALSE, we just have to open the files
 //	representing the bitmap and the directory.
 //
+//	Either way, the bitmap and directory then stay in memory.  The
+//	bitmap has a bit for every sector of the volume, as recorded in the
+//	superblock when it was formatted.  The volume must be striped the
+//	same way as it was then.
+//
 //	"format" -- should we initialize the disk?
 //----------------------------------------------------------------------
 
 FileSystem::FileSystem(bool format) {
+    char *buffer = new char[SectorSize];
+
     DEBUG('f', "Initializing the file system.\n");
     if (format) {
-        BitMap *freeMap = new BitMap(NumSectors);
-        Directory *directory = new Directory(NumDirEntries);
+        superBlock.magic = FileSystemMagic;
+        superBlock.sectorSize = SectorSize;
+        superBlock.numTracks = NumTracks;
+        superBlock.sectorsPerTrack = SectorsPerTrack;
+        superBlock.numSectors = volume->Size();
+        superBlock.numDisks = volume->NumDisks();
+        superBlock.chunkSize = volume->ChunkSize();
+        superBlock.journalStart = DirectorySector + 1;
+        superBlock.journalSize = JournalSectors;
+        bzero(buffer, SectorSize);
+        bcopy((char *) &superBlock, buffer, sizeof(SuperBlock));
+        bufferCache->WriteSector(SuperBlockSector, buffer);
+    } else {
+        bufferCache->ReadSector(SuperBlockSector, buffer);
+        bcopy(buffer, (char *) &superBlock, sizeof(SuperBlock));
+        ASSERT(superBlock.magic == FileSystemMagic);
+        ASSERT(superBlock.sectorSize == SectorSize);
+        ASSERT(superBlock.numSectors <= volume->Size());
+        ASSERT(superBlock.numDisks == volume->NumDisks());
+        ASSERT(superBlock.numDisks == 1
+               || superBlock.chunkSize == volume->ChunkSize());
+    }
+    delete[] buffer;
+
+    freeMap = new BitMap(superBlock.numSectors);
+    directory = new Directory(NumDirEntries);
+    nameCache = new NameCache(NameCacheSize);
+    freeMapDirty = directoryDirty = FALSE;
+    numChanges = 0;
+    journal = new Journal(superBlock.journalStart, superBlock.journalSize,
+                          format);    // on a mount, replays it first
+    if (format) {
         FileHeader *mapHdr = new FileHeader;
         FileHeader *dirHdr = new FileHeader;
 
         DEBUG('f', "Formatting the file system.\n");
 
         // First, allocate space for FileHeaders for the directory and bitmap
-        // (make sure no one else grabs these!)
+        // (make sure no one else grabs these, or the superblock!)
+        freeMap->Mark(SuperBlockSector);
         freeMap->Mark(FreeMapSector);
         freeMap->Mark(DirectorySector);
+        for (int i = 0; i < superBlock.journalSize; i++)
+            freeMap->Mark(superBlock.journalStart + i);
 
         // Second, allocate space for the data blocks containing the contents
         // of the directory and bitmap files.  There better be enough space!
 
-        ASSERT(mapHdr->Allocate(freeMap, FreeMapFileSize));
+        ASSERT(mapHdr->Allocate(freeMap,
+                                FreeMapFileSize(superBlock.numSectors)));
         ASSERT(dirHdr->Allocate(freeMap, DirectoryFileSize));
 
         // Flush the bitmap and directory FileHeaders back to disk
@@ -127,17 +197,235 @@ FileSystem::FileSystem(bool format) {
         if (DebugIsEnabled('f')) {
             freeMap->Print();
             directory->Print();
-
-            delete freeMap;
-            delete directory;
-            delete mapHdr;
-            delete dirHdr;
         }
+        delete mapHdr;
+        delete dirHdr;
     } else {
         // if we are not formatting the disk, just open the files representing
         // the bitmap and directory; these are left open while Nachos is running
         freeMapFile = new OpenFile(FreeMapSector);
         directoryFile = new OpenFile(DirectorySector);
+        freeMap->FetchFrom(freeMapFile);
+        directory->FetchFrom(directoryFile);
+    }
+    bufferCache->SetJournal(journal);
+}
+
+//----------------------------------------------------------------------
+// FileSystem::~FileSystem
+// 	Close the bitmap and directory files.  Everything must have been
+//	synced already: this runs as Nachos halts, when no thread is left
+//	to wait for the disk.
+//----------------------------------------------------------------------
+
+FileSystem::~FileSystem() {
+    ASSERT(!directoryDirty && !freeMapDirty);
+    bufferCache->SetJournal(NULL);
+    delete journal;
+    delete freeMapFile;
+    delete directoryFile;
+    delete freeMap;
+    delete directory;
+    delete nameCache;
+}
+
+//----------------------------------------------------------------------
+// FileSystem::Flush
+// 	Write the in-memory bitmap and directory back to their files, if
+//	need be, and commit the changes of the batch to the journal.
+//----------------------------------------------------------------------
+
+void
+FileSystem::Flush() {
+    numChanges = 0;
+    journal->Begin();
+    WriteBack();
+    journal->End();
+    journal->Commit();
+}
+
+//----------------------------------------------------------------------
+// FileSystem::WriteBack
+// 	Write the in-memory bitmap and directory back to their files, if
+//	they have changed since they were last written.  Called during an
+//	update, so they go into the same transaction as the file headers
+//	that go with them.
+//----------------------------------------------------------------------
+
+void
+FileSystem::WriteBack() {
+    if (directoryDirty) {            // may grow the directory file,
+        directoryDirty = FALSE;        // changing the bitmap: so do it first
+        directory->WriteBack(directoryFile);
+    }
+    if (freeMapDirty) {
+        freeMapDirty = FALSE;
+        freeMap->WriteBack(freeMapFile);
+    }
+}
+
+//----------------------------------------------------------------------
+// FileSystem::Sync
+// 	Get everything onto the disk: the bitmap, the directory, and any
+//	other dirty sectors in the buffer cache -- to their home sectors,
+//	leaving the journal empty.
+//----------------------------------------------------------------------
+
+void
+FileSystem::Sync() {
+    Flush();
+    bufferCache->Sync();
+    journal->Checkpoint();
+}
+
+//----------------------------------------------------------------------
+// FileSystem::BeginUpdate/EndUpdate
+// 	Bracket a change to metadata made outside the file system -- a
+//	file growing, say -- so the sectors written in between are
+//	journaled, and committed with the current batch.
+//----------------------------------------------------------------------
+
+void
+FileSystem::BeginUpdate() {
+    journal->Begin();
+}
+
+void
+FileSystem::EndUpdate() {
+    journal->End();
+}
+
+//----------------------------------------------------------------------
+// FileSystem::Changed
+// 	Note that the in-memory bitmap and/or directory were modified, and
+//	write them back, so the update in progress carries them; commit
+//	the batch if enough changes have piled up.
+//----------------------------------------------------------------------
+
+void
+FileSystem::Changed(bool mapChanged, bool dirChanged) {
+    freeMapDirty = freeMapDirty || mapChanged;
+    directoryDirty = directoryDirty || dirChanged;
+    WriteBack();
+    if (++numChanges >= MetadataBatch)
+        Flush();
+}
+
+//----------------------------------------------------------------------
+// FileSystem::FetchDirectory
+// 	Return the directory whose file header is at "sector", and the
+//	open file holding it.  The root directory is always in memory;
+//	any other directory is read in from disk.  Either way, give it
+//	back with ReleaseDirectory.  Return NULL if the directory on disk
+//	is corrupt.
+//----------------------------------------------------------------------
+
+Directory *
+FileSystem::FetchDirectory(int sector, OpenFile **file) {
+    Directory *dir;
+
+    if (sector == DirectorySector) {
+        *file = directoryFile;
+        return directory;
+    }
+    *file = new OpenFile(sector);
+    dir = new Directory(NumDirEntries);
+    if (!dir->FetchFrom(*file)) {
+        delete dir;
+        delete *file;
+        return NULL;
+    }
+    return dir;
+}
+
+//----------------------------------------------------------------------
+// FileSystem::ReleaseDirectory
+// 	Done with a directory from FetchDirectory.  If it "changed", its
+//	new contents are written back.
+//----------------------------------------------------------------------
+
+void
+FileSystem::ReleaseDirectory(Directory *dir, OpenFile *file, bool changed) {
+    if (dir == directory) {
+        if (changed)
+            Changed(FALSE, TRUE);
+        return;
+    }
+    if (changed)
+        dir->WriteBack(file);
+    delete dir;
+    delete file;
+}
+
+//----------------------------------------------------------------------
+// FileSystem::LookupIn
+// 	Return the header sector of "name" in the directory whose header
+//	is at "dirSector", and whether it is a directory; or -1 if there
+//	is no such file.  Lookups in subdirectories go through the name
+//	cache, so walking a path need not read each directory on the way.
+//----------------------------------------------------------------------
+
+int
+FileSystem::LookupIn(int dirSector, char *name, bool *isDir) {
+    Directory *dir;
+    OpenFile *file;
+    int sector;
+
+    if (dirSector == DirectorySector)
+        return directory->Find(name, isDir);
+
+    sector = nameCache->Find(dirSector, name, isDir);
+    if (sector != -1)
+        return sector;
+    dir = FetchDirectory(dirSector, &file);
+    if (dir == NULL)
+        return -1;
+    sector = dir->Find(name, isDir);
+    if (sector != -1)
+        nameCache->Enter(dirSector, name, sector, *isDir);
+    ReleaseDirectory(dir, file, FALSE);
+    return sector;
+}
+
+//----------------------------------------------------------------------
+// FileSystem::FindParent
+// 	Follow "path" down from the root to the directory that holds (or
+//	should hold) its last component.  Return the header sector of that
+//	directory, and copy the last component into "name"; or return -1
+//	if some directory along the way does not exist, or a name is too
+//	long.
+//
+//	"path" -- names separated by PathSeparator; a leading separator
+//	    is allowed but not needed, since all paths start at the root
+//	"name" -- room for FileNameMaxLen + 1 characters
+//----------------------------------------------------------------------
+
+int
+FileSystem::FindParent(char *path, char *name) {
+    int dirSector = DirectorySector;
+    bool isDir;
+    char *end;
+    int len;
+
+    for (;;) {
+        while (*path == PathSeparator)
+            path++;
+        end = strchr(path, PathSeparator);
+        len = (end == NULL) ? strlen(path) : end - path;
+        if (len > FileNameMaxLen)
+            return -1;
+        strncpy(name, path, len);
+        name[len] = '\0';
+
+        path += len;
+        while (*path == PathSeparator)
+            path++;
+        if (*path == '\0')
+            return dirSector;        // "name" is the last component
+
+        dirSector = LookupIn(dirSector, name, &isDir);
+        if (dirSector == -1 || !isDir)
+            return -1;
     }
 }
 
@@ -147,154 +435,254 @@ FileSystem::FileSystem(bool format) {
 //	Since we can't increase the size of files dynamically, we have
 //	to give Create the initial size of the file.
 //
+//	"name" -- path name of file to be created
+//	"initialSize" -- size of file to be created
+//----------------------------------------------------------------------
+
+bool
+FileSystem::Create(char *name, int initialSize) {
+    DEBUG('f', "Creating file %s, size %d\n", name, initialSize);
+    return CreateEntry(name, initialSize, FALSE);
+}
+
+//----------------------------------------------------------------------
+// FileSystem::MakeDirectory
+// 	Create a new, empty directory (similar to UNIX mkdir).
+//
+//	"name" -- path name of directory to be created
+//----------------------------------------------------------------------
+
+bool
+FileSystem::MakeDirectory(char *name) {
+    DEBUG('f', "Creating directory %s\n", name);
+    return CreateEntry(name, DirectoryFileSize, TRUE);
+}
+
+//----------------------------------------------------------------------
+// FileSystem::AllocateHeader
+// 	Find and mark a sector for the header of a new file in directory
+//	"dirSector", which is to have "dataSectors" sectors of data.
+//	Return -1 if the disk is full.
+//
+//	The disk is divided into allocation groups of GroupTracks tracks,
+//	and a directory belongs to the group holding its header.  A file
+//	is put as near its directory as there is room, with its header
+//	just ahead of its data in the same track, if they fit in one; the
+//	data itself goes right after the header (see FileHeader::Allocate),
+//	so reading the file costs one seek, and then comes from the track
+//	buffer.  A new directory, instead, goes at the start of the group
+//	with the most free space, so directories spread out over the disk
+//	and each has room to keep its files together.
+//
+//	"isDir" -- is the new file a directory?
+//----------------------------------------------------------------------
+
+int
+FileSystem::AllocateHeader(int dirSector, int dataSectors, bool isDir) {
+    int groupSize = GroupTracks * superBlock.sectorsPerTrack;
+    int goal = dirSector, mostFree = -1, numFree, sector;
+
+    if (isDir) {
+        for (int g = 0; g < superBlock.numSectors; g += groupSize) {
+            numFree = freeMap->NumClear(g, g + groupSize);
+            if (numFree > mostFree) {
+                mostFree = numFree;
+                goal = g;
+            }
+        }
+    }
+    sector = freeMap->FindRun(1 + dataSectors, goal,
+                              superBlock.sectorsPerTrack);
+    if (sector == -1)
+        return freeMap->Find(goal);  // no room for the data alongside
+    for (int i = 1; i <= dataSectors; i++)
+        freeMap->Clear(sector + i);  // for FileHeader::Allocate to take
+    return sector;
+}
+
+//----------------------------------------------------------------------
+// FileSystem::CreateEntry
+// 	Create a file or a directory.
+//
 //	The steps to create a file are:
+//	  Find the directory that is to hold it
 //	  Make sure the file doesn't already exist
 //        Allocate a sector for the file header
 // 	  Allocate space on disk for the data blocks for the file
 //	  Add the name to the directory
-//	  Store the new file header on disk 
+//	  Store the new file header on disk
 //	  Flush the changes to the bitmap and the directory back to disk
 //
 //	Return TRUE if everything goes ok, otherwise, return FALSE.
 //
 // 	Create fails if:
+//		directory holding the file doesn't exist, or is corrupt
 //   		file is already in directory
 //	 	no free space for file header
-//	 	no free entry for file in directory
-//	 	no free space for data blocks for the file 
+//	 	file name is empty or too long
+//	 	no free space for data blocks for the file
 //
 // 	Note that this implementation assumes there is no concurrent access
 //	to the file system!
 //
-//	"name" -- name of file to be created
+//	"path" -- path name of file to be created
 //	"initialSize" -- size of file to be created
+//	"isDir" -- is the new file a directory?
 //----------------------------------------------------------------------
 
 bool
-FileSystem::Create(char *name, int initialSize) {
-    Directory *directory;
-    BitMap *freeMap;
+FileSystem::CreateEntry(char *path, int initialSize, bool isDir) {
+    char name[FileNameMaxLen + 1];
+    Directory *dir;
+    OpenFile *file;
     FileHeader *hdr;
-    int sector;
+    int dirSector, sector;
     bool success;
 
-    DEBUG('f', "Creating file %s, size %d\n", name, initialSize);
-
-    directory = new Directory(NumDirEntries);
-    directory->FetchFrom(directoryFile);
+    dirSector = FindParent(path, name);
+    if (dirSector == -1)
+        return FALSE;                // no such directory
+    dir = FetchDirectory(dirSector, &file);
+    if (dir == NULL)
+        return FALSE;                // directory is corrupt
+    journal->Begin();
 
-    if (directory->Find(name) != -1)
+    if (dir->Find(name) != -1)
         success = FALSE;            // file is already in directory
     else {
-        freeMap = new BitMap(NumSectors);
-        freeMap->FetchFrom(freeMapFile);
-        sector = freeMap->Find();    // find a sector to hold the file header
+        // find a sector to hold the file header
+        sector = AllocateHeader(dirSector, divRoundUp(initialSize, SectorSize),
+                                isDir);
         if (sector == -1)
             success = FALSE;        // no free block for file header
-        else if (!directory->Add(name, sector))
-            success = FALSE;    // no space in directory
-        else {
+        else if (!dir->Add(name, sector, isDir)) {
+            success = FALSE;    // bad file name
+            freeMap->Clear(sector);
+        } else {
             hdr = new FileHeader;
-            if (!hdr->Allocate(freeMap, initialSize))
+            if (!hdr->Allocate(freeMap, initialSize, sector + 1)) {
                 success = FALSE;    // no space on disk for data
-            else {
+                dir->Remove(name);
+                freeMap->Clear(sector);
+            } else {
                 success = TRUE;
-                // everthing worked, flush all changes back to disk
+                // everthing worked, the bitmap and directory go to disk
+                // with the next batch
                 hdr->WriteBack(sector);
-                directory->WriteBack(directoryFile);
-                freeMap->WriteBack(freeMapFile);
+                if (isDir) {        // a new directory starts out empty
+                    OpenFile *dirFile = new OpenFile(sector);
+                    Directory *empty = new Directory(1);
+
+                    empty->WriteBack(dirFile);
+                    delete empty;
+                    delete dirFile;
+                }
+                Changed(TRUE, FALSE);
             }
             delete hdr;
         }
-        delete freeMap;
     }
-    delete directory;
+    ReleaseDirectory(dir, file, success);
+    journal->End();
     return success;
 }
 
 //----------------------------------------------------------------------
 // FileSystem::Open
-// 	Open a file for reading and writing.  
+// 	Open a file for reading and writing.
 //	To open a file:
-//	  Find the location of the file's header, using the directory 
+//	  Find the location of the file's header, using the directories
+//	    along its path
 //	  Bring the header into memory
 //
-//	"name" -- the text name of the file to be opened
+//	"name" -- the path name of the file to be opened
 //----------------------------------------------------------------------
 
 OpenFile *
 FileSystem::Open(char *name) {
-    Directory *directory = new Directory(NumDirEntries);
+    char last[FileNameMaxLen + 1];
     OpenFile *openFile = NULL;
-    int sector;
+    int dirSector, sector = -1;
+    bool isDir;
 
     DEBUG('f', "Opening file %s\n", name);
-    directory->FetchFrom(directoryFile);
-    sector = directory->Find(name);
-    if (sector >= 0)
+    dirSector = FindParent(name, last);
+    if (dirSector != -1)
+        sector = LookupIn(dirSector, last, &isDir);
+    if (sector >= 0 && !isDir)
         openFile = new OpenFile(sector);    // name was found in directory
-    delete directory;
     return openFile;                // return NULL if not found
 }
 
 //----------------------------------------------------------------------
 // FileSystem::Remove
-// 	Delete a file from the file system.  This requires:
-//	    Remove it from the directory
+// 	Delete a file, or an empty directory, from the file system.
+//	This requires:
+//	    Remove it from its directory
 //	    Delete the space for its header
 //	    Delete the space for its data blocks
 //	    Write changes to directory, bitmap back to disk
 //
 //	Return TRUE if the file was deleted, FALSE if the file wasn't
-//	in the file system.
+//	in the file system, or is a directory with files in it.
 //
-//	"name" -- the text name of the file to be removed
+//	"name" -- the path name of the file to be removed
 //----------------------------------------------------------------------
 
 bool
 FileSystem::Remove(char *name) {
-    Directory *directory;
-    BitMap *freeMap;
+    char last[FileNameMaxLen + 1];
+    Directory *dir;
+    OpenFile *file;
     FileHeader *fileHdr;
-    int sector;
-
-    directory = new Directory(NumDirEntries);
-    directory->FetchFrom(directoryFile);
-    sector = directory->Find(name);
+    int dirSector, sector;
+    bool isDir;
+
+    dirSector = FindParent(name, last);
+    if (dirSector == -1)
+        return FALSE;                // no such directory
+    dir = FetchDirectory(dirSector, &file);
+    if (dir == NULL)
+        return FALSE;                // directory is corrupt
+    sector = dir->Find(last, &isDir);
+    if (sector != -1 && isDir) {
+        Directory *subdir;
+        OpenFile *subdirFile;
+
+        subdir = FetchDirectory(sector, &subdirFile);
+        if (subdir == NULL || !subdir->IsEmpty())
+            sector = -1;            // only empty directories can go
+        if (subdir != NULL)
+            ReleaseDirectory(subdir, subdirFile, FALSE);
+    }
     if (sector == -1) {
-        delete directory;
+        ReleaseDirectory(dir, file, FALSE);
         return FALSE;             // file not found
     }
     fileHdr = new FileHeader;
     fileHdr->FetchFrom(sector);
 
-    freeMap = new BitMap(NumSectors);
-    freeMap->FetchFrom(freeMapFile);
-
+    journal->Begin();
     fileHdr->Deallocate(freeMap);        // remove data blocks
     freeMap->Clear(sector);            // remove header block
-    directory->Remove(name);
+    dir->Remove(last);
+    nameCache->Forget(dirSector, last);
 
-    freeMap->WriteBack(freeMapFile);        // flush to disk
-    directory->WriteBack(directoryFile);        // flush to disk
+    Changed(TRUE, FALSE);
+    ReleaseDirectory(dir, file, TRUE);
+    journal->End();
     delete fileHdr;
-    delete directory;
-    delete freeMap;
     return TRUE;
 }
 
 //----------------------------------------------------------------------
 // FileSystem::List
-// 	List all the files in the file system directory.
+// 	List all the files in the file system, by path name.
 //----------------------------------------------------------------------
 
 void
 FileSystem::List() {
-    Directory *directory = new Directory(NumDirEntries);
-
-    directory->FetchFrom(directoryFile);
-    directory->List();
-    delete directory;
+    directory->List("");
 }
 
 //----------------------------------------------------------------------
@@ -311,8 +699,13 @@ void
 FileSystem::Print() {
     FileHeader *bitHdr = new FileHeader;
     FileHeader *dirHdr = new FileHeader;
-    BitMap *freeMap = new BitMap(NumSectors);
-    Directory *directory = new Directory(NumDirEntries);
+
+    printf("Disk: %d tracks of %d sectors of %d bytes, %d sectors in use\n",
+           superBlock.numTracks, superBlock.sectorsPerTrack,
+           superBlock.sectorSize, superBlock.numSectors - freeMap->NumClear());
+    if (superBlock.numDisks > 1)
+        printf("Striped over %d disks, in chunks of %d sectors\n",
+               superBlock.numDisks, superBlock.chunkSize);
 
     printf("Bit map file header:\n");
     bitHdr->FetchFrom(FreeMapSector);
@@ -322,14 +715,9 @@ FileSystem::Print() {
     dirHdr->FetchFrom(DirectorySector);
     dirHdr->Print();
 
-    freeMap->FetchFrom(freeMapFile);
     freeMap->Print();
-
-    directory->FetchFrom(directoryFile);
     directory->Print();
 
     delete bitHdr;
     delete dirHdr;
-    delete freeMap;
-    delete directory;
 } 
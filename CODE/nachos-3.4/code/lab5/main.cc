@@ -29,7 +29,8 @@
 //    -f causes the physical disk to be formatted
 //    -cp copies a file from UNIX to Nachos
 //    -p prints a Nachos file to stdout
-//    -r removes a Nachos file from the file system
+//    -r removes a Nachos file (or empty directory) from the file system
+//    -md makes a Nachos directory
 //    -l lists the contents of the Nachos directory
 //    -D prints the contents of the entire file system 
 //    -t tests the performance of the Nachos file system
@@ -147,6 +148,10 @@ main(int argc, char **argv) {
             ASSERT(argc > 1);
             fileSystem->Remove(*(argv + 1));
             argCount = 2;
+        } else if (!strcmp(*argv, "-md")) {	// make Nachos directory
+            ASSERT(argc > 1);
+            fileSystem->MakeDirectory(*(argv + 1));
+            argCount = 2;
         } else if (!strcmp(*argv, "-l")) {	// list Nachos directory
                 fileSystem->List();
         } else if (!strcmp(*argv, "-D")) {	// print entire filesystem
@@ -167,6 +172,10 @@ main(int argc, char **argv) {
 #endif // NETWORK
     }
 
+#ifdef FILESYS
+    fileSystem->Sync();         // while main can still wait for the disk:
+                                // Cleanup can't
+#endif
     currentThread->Finish();    // NOTE: if the procedure "main"
     // returns, then the program "nachos"
     // will exit (as any other normal program
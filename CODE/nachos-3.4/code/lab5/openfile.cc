@@ -28,6 +28,7 @@ OpenFile::OpenFile(int sector) {
     hdr = new FileHeader;
     fileSector = sector;
     hdr->FetchFrom(sector);
+    scratch = new char[SectorSize];
     seekPosition = 0;
 }
 
@@ -37,6 +38,7 @@ OpenFile::OpenFile(int sector) {
 //----------------------------------------------------------------------
 
 OpenFile::~OpenFile() {
+    delete[] scratch;
     delete hdr;
 }
 
@@ -90,14 +92,20 @@ OpenFile::Write(char *into, int numBytes) {
 //	boundary; however the disk only knows how to read/write a whole disk
 //	sector at a time.  Thus:
 //
+//	Sectors the request covers completely are transferred straight
+//	between the caller's buffer and the disk (cache), a run of
+//	sectors that are consecutive on disk at a time.  Only the partial
+//	sectors at either end go through "scratch", a one sector buffer
+//	kept with the open file:
+//
 //	For ReadAt:
-//	   We read in all of the full or partial sectors that are part of the
-//	   request, but we only copy the part we are interested in.
+//	   We read in a partial sector, and copy out the part we want.
 //	For WriteAt:
-//	   We must first read in any sectors that will be partially written,
-//	   so that we don't overwrite the unmodified portion.  We then copy
-//	   in the data that will be modified, and write back all the full
-//	   or partial sectors that are part of the request.
+//	   We must first read in a sector that will be partially written,
+//	   so that we don't overwrite the unmodified portion -- unless it
+//	   lies wholly past the old end of the file, so holds nothing yet.
+//	   We then copy in the data that will be modified, and write the
+//	   sector back.
 //
 //	"into" -- the buffer to contain the data to be read from disk 
 //	"from" -- the buffer containing the data to be written to disk 
@@ -109,8 +117,7 @@ OpenFile::Write(char *into, int numBytes) {
 int
 OpenFile::ReadAt(char *into, int numBytes, int position) {
     int fileLength = hdr->FileLength();
-    int i, firstSector, lastSector, numSectors;
-    char *buf;
+    int i, n, firstSector, lastSector, start, end;
 
     if ((numBytes <= 0) || (position >= fileLength))
         return 0;                // check request
@@ -121,26 +128,29 @@ OpenFile::ReadAt(char *into, int numBytes, int position) {
 
     firstSector = divRoundDown(position, SectorSize);
     lastSector = divRoundDown(position + numBytes - 1, SectorSize);
-    numSectors = 1 + lastSector - firstSector;
-
-    // read in all the full and partial sectors that we need
-    buf = new char[numSectors * SectorSize];
-    for (i = firstSector; i <= lastSector; i++)
-        synchDisk->ReadSector(hdr->ByteToSector(i * SectorSize),
-                              &buf[(i - firstSector) * SectorSize]);
 
-    // copy the part we want
-    bcopy(&buf[position - (firstSector * SectorSize)], into, numBytes);
-    delete[] buf;
+    for (i = firstSector; i <= lastSector; i += n) {
+        n = WholeRun(i, position, position + numBytes);
+        if (n > 0) {
+            bufferCache->ReadSectors(hdr->ByteToSector(i * SectorSize),
+                                     &into[i * SectorSize - position], n);
+            continue;
+        }
+        // the part of sector i we want, as offsets into the file
+        start = max(position, i * SectorSize);
+        end = min(position + numBytes, (i + 1) * SectorSize);
+        bufferCache->ReadSector(hdr->ByteToSector(start), scratch);
+        bcopy(&scratch[start - i * SectorSize], &into[start - position],
+              end - start);
+        n = 1;
+    }
     return numBytes;
 }
 
 int
 OpenFile::WriteAt(char *from, int numBytes, int position) {
     int fileLength = hdr->FileLength();
-    int i, firstSector, lastSector, numSectors;
-    bool firstAligned, lastAligned;
-    char *buf;
+    int i, n, firstSector, lastSector, start, end;
 
     if (numBytes <= 0) {
         return 0;
@@ -148,36 +158,63 @@ OpenFile::WriteAt(char *from, int numBytes, int position) {
     if ((position + numBytes) > fileLength) {
 //        numBytes = fileLength - position;
         int newFileSize = position + numBytes;
-        hdr->Extend(newFileSize);
+        fileSystem->BeginUpdate();
+        int extended = hdr->Extend(fileSystem->GetFreeMap(), newFileSize);
+        if (extended == 2)
+            fileSystem->FreeMapChanged();
+        if (extended > 0)
+            hdr->WriteBack(fileSector);
+        fileSystem->EndUpdate();
+        if (extended < 0)
+            return 0;        // no room to grow the file
     }
     DEBUG('f', "Writing %d bytes at %d, from file of length %d.\n",
           numBytes, position, fileLength);
 
     firstSector = divRoundDown(position, SectorSize);
     lastSector = divRoundDown(position + numBytes - 1, SectorSize);
-    numSectors = 1 + lastSector - firstSector;
 
-    buf = new char[numSectors * SectorSize];
-
-    firstAligned = (bool) (position == (firstSector * SectorSize));
-    lastAligned = (bool) ((position + numBytes) == ((lastSector + 1) * SectorSize));
+    for (i = firstSector; i <= lastSector; i += n) {
+        n = WholeRun(i, position, position + numBytes);
+        if (n > 0) {
+            bufferCache->WriteSectors(hdr->ByteToSector(i * SectorSize),
+                                      &from[i * SectorSize - position], n);
+            continue;
+        }
+        start = max(position, i * SectorSize);
+        end = min(position + numBytes, (i + 1) * SectorSize);
+        // read-modify-write, unless the sector is all new
+        if (i * SectorSize < fileLength)
+            bufferCache->ReadSector(hdr->ByteToSector(start), scratch);
+        else
+            bzero(scratch, SectorSize);
+        bcopy(&from[start - position], &scratch[start - i * SectorSize],
+              end - start);
+        bufferCache->WriteSector(hdr->ByteToSector(start), scratch);
+        n = 1;
+    }
+    return numBytes;
+}
 
-// read in first and last sector, if they are to be partially modified
-    if (!firstAligned)
-        ReadAt(buf, SectorSize, firstSector * SectorSize);
-    if (!lastAligned && ((firstSector != lastSector) || firstAligned))
-        ReadAt(&buf[(lastSector - firstSector) * SectorSize],
-               SectorSize, lastSector * SectorSize);
+//----------------------------------------------------------------------
+// OpenFile::WholeRun
+// 	Return how many sectors of the file, starting with sector "first",
+//	lie wholly within bytes "position" up to "end" of the file, and
+//	follow one another on disk -- so can be transferred as a single
+//	run.  Zero if sector "first" is only partly covered.
+//----------------------------------------------------------------------
 
-// copy in the bytes we want to change 
-    bcopy(from, &buf[position - (firstSector * SectorSize)], numBytes);
+int
+OpenFile::WholeRun(int first, int position, int end) {
+    int sector, n;
 
-// write modified sectors back
-    for (i = firstSector; i <= lastSector; i++)
-        synchDisk->WriteSector(hdr->ByteToSector(i * SectorSize),
-                               &buf[(i - firstSector) * SectorSize]);
-    delete[] buf;
-    return numBytes;
+    if (first * SectorSize < position)
+        return 0;
+    sector = hdr->ByteToSector(first * SectorSize);
+    for (n = 0; (first + n + 1) * SectorSize <= end; n++)
+        if (hdr->ByteToSector((first + n) * SectorSize) != sector + n)
+            break;
+    return n;
 }
 
 //----------------------------------------------------------------------
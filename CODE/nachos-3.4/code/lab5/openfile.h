@@ -94,10 +94,15 @@ public:
     // end of file, tell, lseek back
 
 private:
+    int WholeRun(int first, int position, int end);
+    // How many whole sectors, from the
+    // "first", are consecutive on disk
+
     FileHeader *hdr;            // Header for this file
     int seekPosition;            // Current position within the file
     // fileSector to record the sector when openFile
     int fileSector;
+    char *scratch;            // Holds a partially read/written sector
 };
 
 #endif // FILESYS
@@ -1,25 +1,33 @@
-// synchdisk.cc 
-//	Routines to synchronously access the disk.  The physical disk 
+// synchdisk.cc
+//	Routines to synchronously access the disk.  The physical disk
 //	is an asynchronous device (disk requests return immediately, and
 //	an interrupt happens later on).  This is a layer on top of
 //	the disk providing a synchronous interface (requests wait until
 //	the request completes).
 //
-//	Use a semaphore to synchronize the interrupt handlers with the
-//	pending requests.  And, because the physical disk can only
-//	handle one operation at a time, use a lock to enforce mutual
-//	exclusion.
+//	Each request carries a semaphore (or a callback), which the
+//	interrupt handler signals (or calls) when that request is done.
+//	Because the physical disk can only handle one operation at a time
+//	(or, if it has several channels, that many), requests that arrive
+//	while it is busy wait in a queue; when a request finishes, the
+//	interrupt handler picks the next one according to the scheduling
+//	policy, so that the head doesn't swing back and forth between
+//	tracks when several threads are using the disk.
+//
+//	The queue is shared with the interrupt handler, so it is protected
+//	by turning interrupts off, rather than by a lock.
 //
 // Copyright (c) 1992-1993 The Regents of the University of California.
-// All rights reserved.  See copyright.h for copyright notice and limitation 
+// All rights reserved.  See copyright.h for copyright notice and limitation
 // of liability and disclaimer of warranty provisions.
 
 #include "copyright.h"
 #include "synchdisk.h"
+#include "system.h"
 
 //----------------------------------------------------------------------
 // DiskRequestDone
-// 	Disk interrupt handler.  Need this to be a C routine, because 
+// 	Disk interrupt handler.  Need this to be a C routine, because
 //	C++ can't handle pointers to member functions.
 //----------------------------------------------------------------------
 
@@ -38,13 +46,27 @@ DiskRequestDone (_int arg)
 //
 //	"name" -- UNIX file name to be used as storage for the disk data
 //	   (usually, "DISK")
+//	"policy" -- the order in which to serve queued requests
+//	"numTracks", "sectorsPerTrack" -- the geometry of a new disk, or 0
+//	   to use the existing one (see Disk::Disk)
+//	"flashChannels" -- if not 0, simulate a flash device with that
+//	   many channels, rather than a rotating disk
 //----------------------------------------------------------------------
 
-SynchDisk::SynchDisk(char* name)
+SynchDisk::SynchDisk(char* name, DiskPolicy diskPolicy, int numTracks,
+		     int sectorsPerTrack, int flashChannels)
 {
-    semaphore = new Semaphore("synch disk", 0);
-    lock = new Lock("synch disk lock");
-    disk = new Disk(name, DiskRequestDone, (_int) this);
+    policy = diskPolicy;
+    queue = NULL;
+    numActive = queueLength = 0;
+    headSector = 0;
+    ascending = TRUE;
+    if (flashChannels > 0)
+	disk = new FlashDisk(name, DiskRequestDone, (_int) this,
+			     flashChannels, numTracks, sectorsPerTrack);
+    else
+	disk = new Disk(name, DiskRequestDone, (_int) this, numTracks,
+			sectorsPerTrack);
 }
 
 //----------------------------------------------------------------------
@@ -55,9 +77,8 @@ SynchDisk::SynchDisk(char* name)
 
 SynchDisk::~SynchDisk()
 {
+    ASSERT(numActive == 0 && queue == NULL);
     delete disk;
-    delete lock;
-    delete semaphore;
 }
 
 //----------------------------------------------------------------------
@@ -72,10 +93,7 @@ SynchDisk::~SynchDisk()
 void
 SynchDisk::ReadSector(int sectorNumber, char* data)
 {
-    lock->Acquire();			// only one disk I/O at a time
-    disk->ReadRequest(sectorNumber, data);
-    semaphore->P();			// wait for interrupt
-    lock->Release();
+    Wait(ReadAsync(sectorNumber, data));
 }
 
 //----------------------------------------------------------------------
@@ -90,20 +108,237 @@ SynchDisk::ReadSector(int sectorNumber, char* data)
 void
 SynchDisk::WriteSector(int sectorNumber, char* data)
 {
-    lock->Acquire();			// only one disk I/O at a time
-    disk->WriteRequest(sectorNumber, data);
-    semaphore->P();			// wait for interrupt
-    lock->Release();
+    Wait(WriteAsync(sectorNumber, data));
+}
+
+//----------------------------------------------------------------------
+// SynchDisk::ReadSectors/WriteSectors
+// 	Read/write "count" consecutive sectors as one disk request, and
+//	return once it is done.  The disk seeks once, and interrupts once,
+//	for the whole run.
+//
+//	"sectorNumber" -- the first disk sector to read/write
+//	"data" -- the buffer, "count" sectors long
+//----------------------------------------------------------------------
+
+void
+SynchDisk::ReadSectors(int sectorNumber, char* data, int count)
+{
+    Wait(ReadAsync(sectorNumber, data, count));
+}
+
+void
+SynchDisk::WriteSectors(int sectorNumber, char* data, int count)
+{
+    Wait(WriteAsync(sectorNumber, data, count));
+}
+
+//----------------------------------------------------------------------
+// SynchDisk::ReadAsync/WriteAsync
+// 	Queue a request to read/write disk sectors, and return without
+//	waiting for it.  The buffer must be left alone until the request
+//	completes.
+//
+//	Returns a handle to pass to Wait or WaitAll -- unless a callback
+//	is given, in which case the callback is invoked (from the disk
+//	interrupt handler, so it must not block) when the request
+//	completes, and the request is then freed.
+//
+//	"sectorNumber" -- the first disk sector to read/write
+//	"data" -- the buffer to read into, or to write from
+//	"count" -- how many consecutive sectors
+//	"callWhenDone", "callArg" -- the optional callback
+//----------------------------------------------------------------------
+
+DiskRequest *
+SynchDisk::ReadAsync(int sectorNumber, char* data, int count,
+		     VoidFunctionPtr callWhenDone, _int callArg)
+{
+    return Submit(sectorNumber, data, count, FALSE, callWhenDone, callArg);
+}
+
+DiskRequest *
+SynchDisk::WriteAsync(int sectorNumber, char* data, int count,
+		      VoidFunctionPtr callWhenDone, _int callArg)
+{
+    return Submit(sectorNumber, data, count, TRUE, callWhenDone, callArg);
+}
+
+//----------------------------------------------------------------------
+// SynchDisk::Wait
+// 	Wait until a request from ReadAsync/WriteAsync has completed, and
+//	free it.
+//----------------------------------------------------------------------
+
+void
+SynchDisk::Wait(DiskRequest *request)
+{
+    ASSERT(request->callback == NULL);
+    request->done->P();			// wait for interrupt
+    delete request->done;
+    delete request;
+}
+
+//----------------------------------------------------------------------
+// SynchDisk::WaitAll
+// 	Wait until every request in a batch has completed.  They were all
+//	queued together, so the disk is free to serve them in whatever
+//	order suits the head.
+//----------------------------------------------------------------------
+
+void
+SynchDisk::WaitAll(DiskRequest **requests, int count)
+{
+    for (int i = 0; i < count; i++)
+	Wait(requests[i]);
+}
+
+//----------------------------------------------------------------------
+// SynchDisk::Sync
+// 	Make sure every write that has completed is in the UNIX file
+//	simulating the disk.
+//----------------------------------------------------------------------
+
+void
+SynchDisk::Sync()
+{
+    disk->Sync();
+}
+
+//----------------------------------------------------------------------
+// SynchDisk::Submit
+// 	Make a request.  Send it to the disk if the disk can take it;
+//	otherwise put it at the end of the queue.
+//----------------------------------------------------------------------
+
+DiskRequest *
+SynchDisk::Submit(int sectorNumber, char *data, int count, bool writing,
+		  VoidFunctionPtr callWhenDone, _int callArg)
+{
+    DiskRequest *request = new DiskRequest;
+    DiskRequest **tail;
+    IntStatus oldLevel;
+
+    request->sector = sectorNumber;
+    request->count = count;
+    request->data = data;
+    request->writing = writing;
+    request->callback = callWhenDone;
+    request->callbackArg = callArg;
+    request->done = NULL;
+    if (callWhenDone == NULL)
+	request->done = new Semaphore("disk request", 0);
+
+    oldLevel = interrupt->SetLevel(IntOff);
+    stats->diskQueueTotal += queueLength;
+    if (numActive < disk->Channels())
+	Start(request);
+    else {
+	for (tail = &queue; *tail != NULL; tail = &(*tail)->next)
+	    ;
+	request->next = NULL;
+	*tail = request;
+	queueLength++;
+	if (queueLength > stats->diskQueueMax)
+	    stats->diskQueueMax = queueLength;
+    }
+    (void) interrupt->SetLevel(oldLevel);
+    return request;
+}
+
+//----------------------------------------------------------------------
+// SynchDisk::Start
+// 	Hand a request to the disk, tagged with itself, so we know it
+//	when it finishes.  Interrupts are off.
+//----------------------------------------------------------------------
+
+void
+SynchDisk::Start(DiskRequest *request)
+{
+    stats->diskSeekTracks += abs(request->sector / SectorsPerTrack
+				 - headSector / SectorsPerTrack);
+    numActive++;
+    headSector = request->sector + request->count - 1;
+    if (request->writing)
+	disk->WriteRequest(request->sector, request->data, request->count,
+			   (_int) request);
+    else
+	disk->ReadRequest(request->sector, request->data, request->count,
+			  (_int) request);
+}
+
+//----------------------------------------------------------------------
+// SynchDisk::Distance
+// 	Return how far the head has to go to reach "sector", as the
+//	scheduling policy measures it; the nearest request is served
+//	next.  A negative distance means the request has to wait for
+//	the head to turn around.
+//----------------------------------------------------------------------
+
+int
+SynchDisk::Distance(int sector)
+{
+    switch (policy) {
+      case DiskSSTF:
+	return abs(sector - headSector);
+      case DiskSCAN:
+	return ascending ? sector - headSector : headSector - sector;
+      case DiskCSCAN:			// behind the head: wait for the
+	if (sector < headSector)	// next sweep
+	    return sector - headSector + NumSectors;
+	return sector - headSector;
+      default:				// FIFO: all the same, so the
+	return 0;			// oldest wins
+    }
+}
+
+//----------------------------------------------------------------------
+// SynchDisk::NextRequest
+// 	Remove and return the queued request to serve next, or NULL if
+//	there are none.  Interrupts are off.
+//----------------------------------------------------------------------
+
+DiskRequest *
+SynchDisk::NextRequest()
+{
+    DiskRequest **best, **p, *request;
+
+    if (queue == NULL)
+	return NULL;
+    for (;;) {
+	best = NULL;
+	for (p = &queue; *p != NULL; p = &(*p)->next)
+	    if (Distance((*p)->sector) >= 0 && (best == NULL
+		    || Distance((*p)->sector) < Distance((*best)->sector)))
+		best = p;
+	if (best != NULL)
+	    break;
+	ascending = !ascending;		// SCAN: nothing ahead, turn around
+    }
+    request = *best;
+    *best = request->next;
+    queueLength--;
+    return request;
 }
 
 //----------------------------------------------------------------------
 // SynchDisk::RequestDone
-// 	Disk interrupt handler.  Wake up any thread waiting for the disk
-//	request to finish.
+// 	Disk interrupt handler.  Start the next queued request, and tell
+//	whoever is waiting for the one that just finished.
 //----------------------------------------------------------------------
 
 void
 SynchDisk::RequestDone()
-{ 
-    semaphore->V();
+{
+    DiskRequest *finished = (DiskRequest *) disk->DoneTag();
+    DiskRequest *next;
+
+    numActive--;
+    while (numActive < disk->Channels() && (next = NextRequest()) != NULL)
+	Start(next);
+    if (finished->callback != NULL) {
+	(*finished->callback)(finished->callbackArg);
+	delete finished;
+    } else
+	finished->done->V();
 }
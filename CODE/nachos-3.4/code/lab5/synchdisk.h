@@ -1,9 +1,9 @@
-// synchdisk.h 
-// 	Data structures to export a synchronous interface to the raw 
+// synchdisk.h
+// 	Data structures to export a synchronous interface to the raw
 //	disk device.
 //
 // Copyright (c) 1992-1993 The Regents of the University of California.
-// All rights reserved.  See copyright.h for copyright notice and limitation 
+// All rights reserved.  See copyright.h for copyright notice and limitation
 // of liability and disclaimer of warranty provisions.
 
 #include "copyright.h"
@@ -12,8 +12,33 @@
 #define SYNCHDISK_H
 
 #include "disk.h"
+#include "flashdisk.h"
 #include "synch.h"
 
+// The order in which waiting requests are sent to the disk:
+//	DiskFIFO -- in the order they arrived
+//	DiskSSTF -- the one closest to the head first
+//	DiskSCAN -- sweep the head up and down, like an elevator
+//	DiskCSCAN -- sweep the head up, then start again at the bottom
+
+enum DiskPolicy { DiskFIFO, DiskSSTF, DiskSCAN, DiskCSCAN };
+
+// A request to read or write a run of sectors, waiting for (or being
+// served by) the disk.  When it completes, either its callback is invoked, or
+// (if it has none) its semaphore is signalled.
+
+class DiskRequest {
+  public:
+    int sector;				// first sector to read or write
+    int count;				// how many consecutive sectors
+    char *data;				// where the bytes come from / go to
+    bool writing;			// a write?
+    VoidFunctionPtr callback;		// called when the request completes,
+    _int callbackArg;			// ... with this argument
+    Semaphore *done;			// signalled instead, if no callback
+    DiskRequest *next;			// next request in the queue
+};
+
 // The following class defines a "synchronous" disk abstraction.
 // As with other I/O devices, the raw physical disk is an asynchronous device --
 // requests to read or write portions of the disk return immediately,
@@ -23,31 +48,78 @@
 //
 // This class provides the abstraction that for any individual thread
 // making a request, it waits around until the operation finishes before
-// returning.
+// returning.  Requests from different threads are queued, and sent to
+// the disk one at a time in the order given by the scheduling policy --
+// or, for a device with several channels, as many at a time as it has
+// channels.
+//
+// A thread can also submit requests without waiting for them
+// (ReadAsync/WriteAsync), carry on, and later Wait for one of them, or
+// WaitAll for a batch.  Alternatively, a request can be given a
+// callback, which runs in the disk interrupt handler when the request
+// completes; such a request is freed after its callback, and must not
+// be waited for.
 class SynchDisk {
   public:
-    SynchDisk(char* name);    		// Initialize a synchronous disk,
-					// by initializing the raw Disk.
+    SynchDisk(char* name, DiskPolicy policy = DiskCSCAN,
+	      int numTracks = 0, int sectorsPerTrack = 0,
+	      int flashChannels = 0);
+    					// Initialize a synchronous disk,
+					// by initializing the raw Disk --
+					// or a FlashDisk, if it is to have
+					// channels.
     ~SynchDisk();			// De-allocate the synch disk data
-    
+
     void ReadSector(int sectorNumber, char* data);
     					// Read/write a disk sector, returning
-    					// only once the data is actually read 
-					// or written.  These call
-    					// Disk::ReadRequest/WriteRequest and
-					// then wait until the request is done.
+    					// only once the data is actually read
+					// or written.  These queue a request,
+    					// and then wait until it is done.
     void WriteSector(int sectorNumber, char* data);
-    
+    void ReadSectors(int sectorNumber, char* data, int count);
+    void WriteSectors(int sectorNumber, char* data, int count);
+    					// The same, for "count" consecutive
+					// sectors, as a single request
+
+    DiskRequest *ReadAsync(int sectorNumber, char* data, int count = 1,
+			   VoidFunctionPtr callWhenDone = NULL,
+			   _int callArg = 0);
+    DiskRequest *WriteAsync(int sectorNumber, char* data, int count = 1,
+			    VoidFunctionPtr callWhenDone = NULL,
+			    _int callArg = 0);
+    					// Queue a read/write of "count"
+					// sectors, and return right away
+    void Wait(DiskRequest *request);	// Wait for a request to complete,
+					// and free it
+    void WaitAll(DiskRequest **requests, int count);
+    					// Wait for a batch of requests
+
+    void Sync();			// Make sure what has been written
+					// survives Nachos exiting
+
     void RequestDone();			// Called by the disk device interrupt
 					// handler, to signal that the
 					// current disk operation is complete.
 
   private:
+    DiskRequest *Submit(int sectorNumber, char *data, int count,
+			bool writing, VoidFunctionPtr callWhenDone,
+			_int callArg);
+    					// Queue a request, starting it
+					// right away if the disk is idle
+    void Start(DiskRequest *request);	// Send a request to the disk
+    DiskRequest *NextRequest();		// Take the request to serve next
+					// off the queue
+    int Distance(int sector);		// How far "sector" is from the
+					// head, as the policy sees it
+
     Disk *disk;		  		// Raw disk device
-    Semaphore *semaphore; 		// To synchronize requesting thread 
-					// with the interrupt handler
-    Lock *lock;		  		// Only one read/write request
-					// can be sent to the disk at a time
+    DiskPolicy policy;			// Order to serve requests in
+    DiskRequest *queue;			// Requests not yet sent to the disk
+    int queueLength;
+    int numActive;			// Requests the disk is working on
+    int headSector;			// Last sector of the last request sent
+    bool ascending;			// Direction of the SCAN sweep
 };
 
 #endif // SYNCHDISK_H
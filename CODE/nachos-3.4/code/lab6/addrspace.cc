@@ -19,6 +19,9 @@
 #include "system.h"
 #include "addrspace.h"
 #include "noff.h"
+#include "syscall.h"
+#include "ioring.h"
+#include "pipe.h"
 
 //----------------------------------------------------------------------
 // SwapHeader
@@ -75,6 +78,12 @@ AddrSpace::AddrSpace(OpenFile *executable) {
     }
     ASSERT(flag);
 
+    for (i = 0; i < MaxOpenFiles; i++) {
+        fileTable[i] = NULL;
+        pipeTable[i] = NULL;
+    }
+    ring = NULL;
+
     executable->ReadAt((char *) &noffH, sizeof(noffH), 0);
     if ((noffH.noffMagic != NOFFMAGIC) &&
         (WordToHost(noffH.noffMagic) == NOFFMAGIC))
@@ -88,7 +97,7 @@ AddrSpace::AddrSpace(OpenFile *executable) {
     numPages = divRoundUp(size, PageSize);
     size = numPages * PageSize;
 
-    ASSERT(numPages <= NumPhysPages);        // check we're not trying
+    ASSERT(numPages < NumPhysPages);         // check we're not trying
     // to run anything too big --
     // at least until we have
     // virtual memory
@@ -96,7 +105,7 @@ AddrSpace::AddrSpace(OpenFile *executable) {
     DEBUG('a', "Initializing address space, num pages %d, size %d\n",
           numPages, size);
 // first, set up the translation 
-    pageTable = new TranslationEntry[numPages];
+    pageTable = new TranslationEntry[numPages + 1];
     for (i = 0; i < numPages; i++) {
         pageTable[i].virtualPage = i;    // for now, virtual page # = phys page #
         pageTable[i].physicalPage = bitmap->Find();
@@ -108,6 +117,20 @@ AddrSpace::AddrSpace(OpenFile *executable) {
         // pages to be read-only
     }
 
+// then map the clock page, shared by every address space, read-only
+// after the stack; the first address space sets it up
+    if (machine->clockFrame == -1) {
+        machine->clockFrame = bitmap->Find();
+        ASSERT(machine->clockFrame != -1);
+        machine->UpdateClockPage();
+    }
+    pageTable[numPages].virtualPage = numPages;
+    pageTable[numPages].physicalPage = machine->clockFrame;
+    pageTable[numPages].valid = TRUE;
+    pageTable[numPages].use = FALSE;
+    pageTable[numPages].dirty = FALSE;
+    pageTable[numPages].readOnly = TRUE;
+
 // zero out the entire address space, to zero the unitialized data segment 
 // and the stack segment
 // not zero out the entire address space for multi program
@@ -117,32 +140,52 @@ AddrSpace::AddrSpace(OpenFile *executable) {
     if (noffH.code.size > 0) {
         DEBUG('a', "Initializing code segment, at 0x%x, size %d\n",
               noffH.code.virtualAddr, noffH.code.size);
-        int code_page = noffH.code.virtualAddr / PageSize;
-        int page_offset = noffH.code.virtualAddr % PageSize;
-        int physical_addr = pageTable[code_page].physicalPage * PageSize + page_offset;
-        executable->ReadAt(&(machine->mainMemory[physical_addr]),
-                           noffH.code.size, noffH.code.inFileAddr);
+        LoadSegment(executable, noffH.code.virtualAddr, noffH.code.size,
+                    noffH.code.inFileAddr);
     }
     if (noffH.initData.size > 0) {
         DEBUG('a', "Initializing data segment, at 0x%x, size %d\n",
               noffH.initData.virtualAddr, noffH.initData.size);
-        int data_page = noffH.initData.virtualAddr / PageSize;
-        int page_offset = noffH.initData.virtualAddr % PageSize;
-        int physical_addr = pageTable[data_page].physicalPage * PageSize + page_offset;
-        executable->ReadAt(&(machine->mainMemory[physical_addr]),
-                           noffH.initData.size, noffH.initData.inFileAddr);
+        LoadSegment(executable, noffH.initData.virtualAddr,
+                    noffH.initData.size, noffH.initData.inFileAddr);
     }
 
     Print();
 }
 
+//----------------------------------------------------------------------
+// AddrSpace::LoadSegment
+// 	Read "size" bytes at "inFileAddr" in "executable" into the address
+//	space at "virtAddr".  The frames come from wherever the bitmap had
+//	them free, so they need not be contiguous: read a page at a time,
+//	through the page table.
+//----------------------------------------------------------------------
+
+void AddrSpace::LoadSegment(OpenFile *executable, int virtAddr, int size,
+                            int inFileAddr) {
+    int done, chunk, physAddr;
+
+    for (done = 0; done < size; done += chunk) {
+        chunk = PageSize - ((virtAddr + done) % PageSize);
+        if (chunk > size - done)
+            chunk = size - done;
+        physAddr = UserToPhys(virtAddr + done);
+        ASSERT(physAddr != -1);
+        executable->ReadAt(&machine->mainMemory[physAddr], chunk,
+                           inFileAddr + done);
+    }
+}
+
 //----------------------------------------------------------------------
 // AddrSpace::~AddrSpace
 // 	Dealloate an address space.  Nothing for now!
 //----------------------------------------------------------------------
 
 AddrSpace::~AddrSpace() {
-    spaceIdMap[spaceId] = false;
+    if (ring != NULL)
+        ring->Shutdown();                // the ring's worker frees it
+    for (int fd = 0; fd < MaxOpenFiles; fd++)
+        ReleaseFd(fd);                   // close anything left open
 
     for (int i = 0; i < numPages; ++i) {
         bitmap->Clear(pageTable[i].physicalPage);
@@ -150,6 +193,16 @@ AddrSpace::~AddrSpace() {
     delete[] pageTable;
 }
 
+//----------------------------------------------------------------------
+// AddrSpace::ReleaseSpaceId
+// 	Let a new address space have "id".  Not done when the old one is
+//	deleted, since its parent may still Join it (see exception.cc).
+//----------------------------------------------------------------------
+
+void AddrSpace::ReleaseSpaceId(int id) {
+    spaceIdMap[id] = false;
+}
+
 //----------------------------------------------------------------------
 // AddrSpace::InitRegisters
 // 	Set the initial values for the user-level register set.
@@ -196,12 +249,15 @@ void AddrSpace::SaveState() {}
 // 	On a context switch, restore the machine state so that
 //	this address space can run.
 //
-//      For now, tell the machine where to find the page table.
+//      Tell the machine where to find the page table (including the
+//	clock page), and record in the clock page who is running.
 //----------------------------------------------------------------------
 
 void AddrSpace::RestoreState() {
     machine->pageTable = pageTable;
-    machine->pageTableSize = numPages;
+    machine->pageTableSize = numPages + 1;
+    *(unsigned int *) &machine->mainMemory[machine->clockFrame * PageSize
+                                           + ClockSpaceId] = WordToMachine(spaceId);
 }
 
 void AddrSpace::Print() {
@@ -215,3 +271,214 @@ void AddrSpace::Print() {
     printf("============================================\n\n"
     );
 }
+
+//----------------------------------------------------------------------
+// AddrSpace::AllocateFd
+// 	Enter an open file into this address space's open file table.
+//	The console ids (ConsoleInput, ConsoleOutput) are never handed out.
+//	Return the OpenFileId for the file, or -1 if the table is full.
+//
+//	"file" is the open file to be owned by this address space
+//----------------------------------------------------------------------
+
+int AddrSpace::AllocateFd(OpenFile *file) {
+    for (int fd = ConsoleOutput + 1; fd < MaxOpenFiles; fd++) {
+        if (fileTable[fd] == NULL && pipeTable[fd] == NULL) {
+            fileTable[fd] = file;
+            return fd;
+        }
+    }
+    return -1;
+}
+
+//----------------------------------------------------------------------
+// AddrSpace::GetFile
+// 	Return the open file for OpenFileId "fd", or NULL if "fd" is out
+//	of range or not open.
+//----------------------------------------------------------------------
+
+OpenFile *AddrSpace::GetFile(int fd) {
+    if (fd <= ConsoleOutput || fd >= MaxOpenFiles)
+        return NULL;
+    return fileTable[fd];
+}
+
+//----------------------------------------------------------------------
+// AddrSpace::ReleaseFd
+// 	Close OpenFileId "fd" and free its slot in the open file table.
+//	Closing a redirected ConsoleInput/ConsoleOutput closes the pipe
+//	end and makes the id refer to the console again.
+//----------------------------------------------------------------------
+
+void AddrSpace::ReleaseFd(int fd) {
+    OpenFile *file = GetFile(fd);
+
+    if (file != NULL) {
+        delete file;
+        fileTable[fd] = NULL;
+    }
+    if (fd >= 0 && fd < MaxOpenFiles && pipeTable[fd] != NULL) {
+        pipeTable[fd]->CloseEnd(pipeWriter[fd]);
+        pipeTable[fd] = NULL;
+    }
+}
+
+//----------------------------------------------------------------------
+// AddrSpace::AllocatePipeFd
+// 	Enter one end of a pipe into the open file table, counting it as
+//	an open end of the pipe.  Return its OpenFileId, or -1 if the
+//	table is full.
+//
+//	"writeEnd" -- TRUE for the writing end, FALSE for the reading end
+//----------------------------------------------------------------------
+
+int AddrSpace::AllocatePipeFd(PipeBuffer *pipe, bool writeEnd) {
+    for (int fd = ConsoleOutput + 1; fd < MaxOpenFiles; fd++) {
+        if (fileTable[fd] == NULL && pipeTable[fd] == NULL) {
+            RedirectConsole(fd, pipe, writeEnd);
+            return fd;
+        }
+    }
+    return -1;
+}
+
+//----------------------------------------------------------------------
+// AddrSpace::RedirectConsole
+// 	Make OpenFileId "fd" (normally ConsoleInput or ConsoleOutput, when
+//	a program is Exec'ed with a pipe as its input or output) refer to
+//	one end of "pipe".
+//----------------------------------------------------------------------
+
+void AddrSpace::RedirectConsole(int fd, PipeBuffer *pipe, bool writeEnd) {
+    ReleaseFd(fd);
+    pipe->OpenEnd(writeEnd);
+    pipeTable[fd] = pipe;
+    pipeWriter[fd] = writeEnd;
+}
+
+//----------------------------------------------------------------------
+// AddrSpace::GetPipe
+// 	Return the pipe for OpenFileId "fd", or NULL if "fd" is not the
+//	reading end (if "writing" is FALSE) or writing end (if TRUE) of
+//	a pipe.
+//----------------------------------------------------------------------
+
+PipeBuffer *AddrSpace::GetPipe(int fd, bool writing) {
+    if (fd < 0 || fd >= MaxOpenFiles || pipeTable[fd] == NULL
+        || pipeWriter[fd] != writing)
+        return NULL;
+    return pipeTable[fd];
+}
+
+//----------------------------------------------------------------------
+// AddrSpace::UserToPhys
+// 	Translate a virtual address of this address space to an offset in
+//	machine->mainMemory, using our own page table rather than the
+//	machine's, so kernel threads can reach user memory too.
+//	Return -1 if "virtAddr" is not mapped.
+//----------------------------------------------------------------------
+
+int AddrSpace::UserToPhys(int virtAddr) {
+    unsigned int vpn = (unsigned) virtAddr / PageSize;
+
+    if (virtAddr < 0 || vpn >= numPages || !pageTable[vpn].valid)
+        return -1;
+    pageTable[vpn].use = TRUE;
+    return pageTable[vpn].physicalPage * PageSize + virtAddr % PageSize;
+}
+
+//----------------------------------------------------------------------
+// AddrSpace::Copy
+// 	Copy "size" bytes between a kernel buffer and user memory at
+//	"virtAddr", one page at a time.  Return the number of bytes copied,
+//	which is short only if the user address is bad.
+//
+//	"toUser" -- TRUE to copy kernel -> user, FALSE for user -> kernel
+//----------------------------------------------------------------------
+
+int AddrSpace::Copy(int virtAddr, char *buf, int size, bool toUser) {
+    int done = 0;
+    int physAddr, chunk;
+
+    while (done < size) {
+        chunk = PageSize - ((virtAddr + done) % PageSize);
+        if (chunk > size - done)
+            chunk = size - done;
+        if ((physAddr = UserToPhys(virtAddr + done)) == -1)
+            break;
+        if (toUser)
+            bcopy(&buf[done], &machine->mainMemory[physAddr], chunk);
+        else
+            bcopy(&machine->mainMemory[physAddr], &buf[done], chunk);
+        done += chunk;
+    }
+    return done;
+}
+
+//----------------------------------------------------------------------
+// AddrSpace::FileIO
+// 	Move "size" bytes between an open file and user memory at "virtAddr",
+//	starting at the file's current position.  Return the number of
+//	bytes actually transferred.
+//
+//	The user buffer is split at page boundaries, and each piece is
+//	handed to OpenFile::Read/Write in place, straight out of (or into)
+//	the physical frame in machine->mainMemory -- there is no kernel
+//	staging buffer.  lab6 is built with FILESYS_STUB, so each piece is
+//	one read or write of the UNIX file behind the OpenFile.
+//----------------------------------------------------------------------
+
+int AddrSpace::FileIO(OpenFile *file, int virtAddr, int size, bool writing) {
+    int done = 0;
+    int physAddr, chunk, result;
+
+    while (done < size) {
+        chunk = PageSize - ((virtAddr + done) % PageSize);
+        if (chunk > size - done)
+            chunk = size - done;
+        if ((physAddr = UserToPhys(virtAddr + done)) == -1)
+            break;                      // bad user address, stop here
+        if (writing)
+            result = file->Write(&machine->mainMemory[physAddr], chunk);
+        else
+            result = file->Read(&machine->mainMemory[physAddr], chunk);
+        done += result;
+        if (result < chunk)
+            break;                      // end of file
+    }
+    return done;
+}
+
+//----------------------------------------------------------------------
+// AddrSpace::PipeIO
+// 	Move "size" bytes between a pipe and user memory at "virtAddr",
+//	page by page and in place, like FileIO.  Return the number of
+//	bytes transferred.
+//
+//	A read waits only for the first page's worth: after that it takes
+//	whatever is already buffered and returns, so a reader is not held
+//	up waiting to fill a large buffer.  A read of 0 bytes means every
+//	writer has closed the pipe.
+//----------------------------------------------------------------------
+
+int AddrSpace::PipeIO(PipeBuffer *pipe, int virtAddr, int size, bool writing) {
+    int done = 0;
+    int physAddr, chunk, result;
+
+    while (done < size) {
+        chunk = PageSize - ((virtAddr + done) % PageSize);
+        if (chunk > size - done)
+            chunk = size - done;
+        if ((physAddr = UserToPhys(virtAddr + done)) == -1)
+            break;                      // bad user address, stop here
+        if (writing)
+            result = pipe->Write(&machine->mainMemory[physAddr], chunk);
+        else
+            result = pipe->Read(&machine->mainMemory[physAddr], chunk,
+                                done == 0);
+        done += result;
+        if (result < chunk)
+            break;                      // pipe drained, or other end gone
+    }
+    return done;
+}
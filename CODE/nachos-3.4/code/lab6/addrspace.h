@@ -18,7 +18,13 @@
 #include "bitmap.h"
 #include "machine.h"
 
+class IoRing;
+class PipeBuffer;
+
 #define UserStackSize		1024 	// increase this as necessary!
+#define MaxOpenFiles		16	// size of the per-process open file
+					// table, including the two console
+					// ids (ConsoleInput, ConsoleOutput)
 
 class AddrSpace {
   public:
@@ -35,8 +41,44 @@ class AddrSpace {
 
     void Print();
     int getSpaceId() { return spaceId; }
+    static void ReleaseSpaceId(int id);	// Make a SpaceId free for reuse
+    int getClockAddr() { return numPages * PageSize; }
+					// Virtual address of the clock page,
+					// mapped just past the stack
+
+    int AllocateFd(OpenFile *file);	// Put "file" in the open file table,
+					// return its OpenFileId or -1 if full
+    OpenFile *GetFile(int fd);		// Look up an OpenFileId, NULL if
+					// not open
+    void ReleaseFd(int fd);		// Close an OpenFileId
+    int AllocatePipeFd(PipeBuffer *pipe, bool writeEnd);
+					// Put one end of "pipe" in the table,
+					// return its OpenFileId or -1
+    void RedirectConsole(int fd, PipeBuffer *pipe, bool writeEnd);
+					// Make ConsoleInput/ConsoleOutput
+					// refer to one end of "pipe"
+    PipeBuffer *GetPipe(int fd, bool writing);
+					// Look up a pipe end, NULL if "fd"
+					// is not that kind of pipe end
+
+    int UserToPhys(int virtAddr);	// Physical address backing user
+					// address "virtAddr", -1 if unmapped
+    int Copy(int virtAddr, char *buf, int size, bool toUser);
+					// Copy between user memory and a
+					// kernel buffer
+    int FileIO(OpenFile *file, int virtAddr, int size, bool writing);
+					// Read/write a file straight into/out
+					// of user memory
+    int PipeIO(PipeBuffer *pipe, int virtAddr, int size, bool writing);
+					// Same, for a pipe
+
+    IoRing *ring;			// Submission/completion ring shared
+					// with the kernel, NULL if none
 
   private:
+    void LoadSegment(OpenFile *executable, int virtAddr, int size,
+		     int inFileAddr);	// Read part of the program into
+					// memory, a page at a time
     TranslationEntry *pageTable;	// Assume linear page table translation
 					// for now!
     unsigned int numPages;		// Number of pages in the virtual 
@@ -44,6 +86,12 @@ class AddrSpace {
     static BitMap *bitmap;
     static bool spaceIdMap[128];
     int spaceId;
+    OpenFile *fileTable[MaxOpenFiles];	// files opened by this process,
+					// indexed by OpenFileId
+    PipeBuffer *pipeTable[MaxOpenFiles];	// pipe ends open in this process,
+					// indexed by OpenFileId
+    bool pipeWriter[MaxOpenFiles];	// TRUE if pipeTable[fd] is the
+					// writing end
 };
 
 #endif // ADDRSPACE_H
@@ -24,16 +24,202 @@
 #include "copyright.h"
 #include "system.h"
 #include "syscall.h"
+#include "console.h"
+#include "synch.h"
+#include "ioring.h"
+#include "pipe.h"
 
-AddrSpace *space;
+#define MaxFileNameLen 50    // longest file name a user program may pass
+#define MaxSpaceIds 128      // number of SpaceId's (see AddrSpace::spaceIdMap)
+#define UserIoVecSize 8      // sizeof(IoVec) as laid out by the MIPS
+#define IoVecStage (8 * SectorSize)  // most bytes moved by one ReadV/WriteV
+                                     // file operation
+                             // compiler: a 4 byte pointer and an int
 
 void AdvancePC();
 
-void StartProcess(int _which) {
-    currentThread->space = space;
+// The console backing ConsoleInput/ConsoleOutput, created the first time
+// a user program touches it.  As in ConsoleTest, the requesting thread
+// waits on a semaphore until the device interrupt says the I/O is done.
 
-    space->InitRegisters();        // set the initial register values
-    space->RestoreState();        // load page table register
+static Console *console = NULL;
+static Semaphore *readAvail;
+static Semaphore *writeDone;
+
+static void ReadAvail(_int arg) { readAvail->V(); }
+static void WriteDone(_int arg) { writeDone->V(); }
+
+static void
+StartConsole() {
+    if (console == NULL) {
+        readAvail = new Semaphore("console read avail", 0);
+        writeDone = new Semaphore("console write done", 0);
+        console = new Console(NULL, NULL, ReadAvail, WriteDone, 0);
+    }
+}
+
+// Exit status of each SpaceId, for Join.  A SpaceId is "running" from
+// the time ExecProgram hands it out until the program calls Exit.  Only
+// the parent may Join a program, so its SpaceId is kept (and not handed
+// to a new program) until the parent has joined it, or has exited
+// itself; "parentOf" is -1 once nobody can join it any more.
+
+static Lock *exitLock = NULL;
+static Condition *exitDone;
+static bool running[MaxSpaceIds];
+static int exitStatus[MaxSpaceIds];
+static int parentOf[MaxSpaceIds];
+
+static void
+StartExitTable() {
+    if (exitLock == NULL) {
+        exitLock = new Lock("exit lock");
+        exitDone = new Condition("exit done");
+        for (int i = 0; i < MaxSpaceIds; i++)
+            parentOf[i] = -1;
+    }
+}
+
+//----------------------------------------------------------------------
+// ReadString
+// 	Copy a '\0' terminated string out of user memory, truncating it
+//	to "size" bytes (including the terminator).
+//
+//	"addr" -- virtual address of the string in the user program
+//	"into" -- kernel buffer to hold the string
+//----------------------------------------------------------------------
+
+static void
+ReadString(int addr, char *into, int size) {
+    int i = 0;
+    int ch;
+
+    do {
+        machine->ReadMem(addr + i, 1, &ch);
+        into[i] = (char) ch;
+    } while (into[i] != '\0' && ++i < size);
+    into[size - 1] = '\0';
+}
+
+//----------------------------------------------------------------------
+// MappedLength
+// 	Return how many of the "size" bytes of user memory at "virtAddr"
+//	are mapped, counting from the start.
+//----------------------------------------------------------------------
+
+static int
+MappedLength(int virtAddr, int size) {
+    int done = 0, chunk;
+
+    while (done < size) {
+        if (currentThread->space->UserToPhys(virtAddr + done) == -1)
+            break;
+        chunk = PageSize - ((virtAddr + done) % PageSize);
+        done += (chunk < size - done) ? chunk : size - done;
+    }
+    return done;
+}
+
+//----------------------------------------------------------------------
+// CopyIoVecs
+// 	Move "size" bytes between "stage" and the user buffers "base",
+//	"len", starting "*offset" bytes into buffer "*i"; leave "*i" and
+//	"*offset" just past them.
+//----------------------------------------------------------------------
+
+static void
+CopyIoVecs(int *base, int *len, int *i, int *offset, char *stage, int size,
+           bool toUser) {
+    int done = 0, chunk;
+
+    while (done < size) {
+        chunk = len[*i] - *offset;
+        if (chunk > size - done)
+            chunk = size - done;
+        currentThread->space->Copy(base[*i] + *offset, &stage[done], chunk,
+                                   toUser);
+        done += chunk;
+        *offset += chunk;
+        if (*offset == len[*i]) {
+            (*i)++;
+            *offset = 0;
+        }
+    }
+}
+
+//----------------------------------------------------------------------
+// UserFileIOV
+// 	Scatter/gather version of AddrSpace::FileIO.  "iovAddr" points at
+//	"count" IoVec's in user memory, describing buffers that are
+//	consecutive in the file starting at its current position.  Return
+//	the total number of bytes transferred, or -1 if the IoVec array is
+//	bad.
+//
+//	Adjacent buffers are gathered into a kernel buffer of IoVecStage
+//	bytes, and each full buffer is one Read or Write of the file, so
+//	small records don't cost a file operation each.  The transfer
+//	ends at the first bad user address, or at the end of the file.
+//----------------------------------------------------------------------
+
+static int
+UserFileIOV(OpenFile *file, int iovAddr, int count, bool writing) {
+    int base[MaxIoVecs], len[MaxIoVecs];
+    int i, offset, size, done, total = 0, wanted = 0;
+    char *stage;
+
+    if (count <= 0 || count > MaxIoVecs)
+        return -1;
+    for (i = 0; i < count; i++)
+        if (!machine->ReadMem(iovAddr + i * UserIoVecSize, 4, &base[i]) ||
+            !machine->ReadMem(iovAddr + i * UserIoVecSize + 4, 4, &len[i]) ||
+            len[i] < 0 || len[i] > 0x7fffffff - wanted)
+            return -1;
+        else
+            wanted += len[i];
+
+    // stop at the first byte that isn't mapped, so the copies can't fail
+    for (i = 0, wanted = 0; i < count; i++) {
+        size = MappedLength(base[i], len[i]);
+        wanted += size;
+        if (size < len[i]) {
+            len[i] = size;
+            count = i + 1;
+        }
+    }
+
+    stage = new char[IoVecStage];
+    for (i = offset = 0; total < wanted; total += done) {
+        size = (wanted - total < IoVecStage) ? wanted - total : IoVecStage;
+        if (writing) {
+            CopyIoVecs(base, len, &i, &offset, stage, size, FALSE);
+            done = file->Write(stage, size);
+        } else {
+            done = file->Read(stage, size);
+            CopyIoVecs(base, len, &i, &offset, stage, done, TRUE);
+        }
+        if (done < size) {              // end of file, or out of space
+            total += done;
+            break;
+        }
+    }
+    delete [] stage;
+    return total;
+}
+
+//----------------------------------------------------------------------
+// StartProcess
+// 	First routine run by the thread of a freshly Exec'ed program:
+//	install its address space and jump into user mode.
+//
+//	"arg" is the AddrSpace of the new program
+//----------------------------------------------------------------------
+
+static void
+StartProcess(_int arg) {
+    currentThread->space = (AddrSpace *) arg;
+
+    currentThread->space->InitRegisters();    // set the initial register values
+    currentThread->space->RestoreState();     // load page table register
 
     machine->Run();            // jump to the user progam
     ASSERT(FALSE);            // machine->Run never returns;
@@ -41,6 +227,46 @@ void StartProcess(int _which) {
     // by doing the syscall "exit"
 }
 
+//----------------------------------------------------------------------
+// ExecProgram
+// 	Load the executable "filename" into a new address space and start
+//	a thread running it.  Return the new SpaceId, or -1 if the file
+//	could not be opened.
+//
+//	"parent" -- the program asking, which may Join the new one (passed
+//	   in, since a ring's worker thread asks on its owner's behalf)
+//	"input", "output" -- if these are pipe ends of the parent, the new
+//	   program's ConsoleInput/ConsoleOutput are connected to them
+//----------------------------------------------------------------------
+
+int
+ExecProgram(char *filename, AddrSpace *parent, int input, int output) {
+    OpenFile *executable = fileSystem->Open(filename);
+    PipeBuffer *pipe;
+
+    if (executable == NULL) {
+        printf("Unable to open file %s\n", filename);
+        return -1;
+    }
+    AddrSpace *space = new AddrSpace(executable);
+
+    delete executable;            // close file
+
+    if (parent != NULL && (pipe = parent->GetPipe(input, FALSE)) != NULL)
+        space->RedirectConsole(ConsoleInput, pipe, FALSE);
+    if (parent != NULL && (pipe = parent->GetPipe(output, TRUE)) != NULL)
+        space->RedirectConsole(ConsoleOutput, pipe, TRUE);
+
+    StartExitTable();
+    running[space->getSpaceId()] = TRUE;
+    parentOf[space->getSpaceId()] =
+        (parent == NULL) ? -1 : parent->getSpaceId();
+
+    Thread *thread = new Thread("executing new thread");
+    thread->Fork(StartProcess, (_int) space);
+    return space->getSpaceId();
+}
+
 //----------------------------------------------------------------------
 // ExceptionHandler
 // 	Entry point into the Nachos kernel.  Called when a user program
@@ -68,33 +294,209 @@ void
 ExceptionHandler(ExceptionType which) {
     int type = machine->ReadRegister(2);
 
+    if (which == SyscallException)
+        syscallTrace->Begin(type, currentThread->space->getSpaceId());
+
     if ((which == SyscallException) && (type == SC_Halt)) {
         DEBUG('a', "Shutdown, initiated by user program.\n");
         interrupt->Halt();
-    } else if ((which == SyscallException) && (type == SC_Exec)) {
-        char filename[50];
+    } else if ((which == SyscallException) && (type == SC_Exit)) {
+        AddrSpace *space = currentThread->space;
+        int spaceId = space->getSpaceId();
+        int status = machine->ReadRegister(4);
+
+        DEBUG('a', "Program %d exits with status %d\n", spaceId, status);
+        currentThread->space = NULL;
+        delete space;                   // closes its files and pipe ends
+
+        StartExitTable();
+        exitLock->Acquire();
+        running[spaceId] = FALSE;
+        exitStatus[spaceId] = status;
+        for (int child = 0; child < MaxSpaceIds; child++)
+            if (parentOf[child] == spaceId) {
+                parentOf[child] = -1;   // orphaned: nobody will join it
+                if (!running[child])
+                    AddrSpace::ReleaseSpaceId(child);
+            }
+        if (parentOf[spaceId] == -1)
+            AddrSpace::ReleaseSpaceId(spaceId);
+        exitDone->Broadcast(exitLock);
+        exitLock->Release();
+
+        currentThread->Finish();
+    } else if ((which == SyscallException) &&
+               ((type == SC_Exec) || (type == SC_ExecIO))) {
+        char filename[MaxFileNameLen];
+        ReadString(machine->ReadRegister(4), filename, MaxFileNameLen);
+
+        int spaceId;
+        if (type == SC_ExecIO)
+            spaceId = ExecProgram(filename, currentThread->space,
+                                  machine->ReadRegister(5),
+                                  machine->ReadRegister(6));
+        else
+            spaceId = ExecProgram(filename, currentThread->space);
+        currentThread->Yield();
+
+        machine->WriteRegister(2, spaceId);
+
+        AdvancePC();
+    } else if ((which == SyscallException) && (type == SC_Join)) {
+        int spaceId = machine->ReadRegister(4);
+        int status = -1;
+
+        StartExitTable();
+        exitLock->Acquire();
+        if (spaceId >= 0 && spaceId < MaxSpaceIds &&
+            parentOf[spaceId] == currentThread->space->getSpaceId()) {
+            while (running[spaceId])
+                exitDone->Wait(exitLock);
+            status = exitStatus[spaceId];
+            parentOf[spaceId] = -1;     // joined: the id may be reused
+            AddrSpace::ReleaseSpaceId(spaceId);
+        }
+        exitLock->Release();
+        DEBUG('a', "Join %d: status %d\n", spaceId, status);
+        machine->WriteRegister(2, status);
+        AdvancePC();
+    } else if ((which == SyscallException) && (type == SC_Create)) {
+        char filename[MaxFileNameLen];
+        ReadString(machine->ReadRegister(4), filename, MaxFileNameLen);
+
+        DEBUG('a', "Create file %s\n", filename);
+        if (!fileSystem->Create(filename, 0))
+            printf("Unable to create file %s\n", filename);
+        AdvancePC();
+    } else if ((which == SyscallException) && (type == SC_Open)) {
+        char filename[MaxFileNameLen];
+        ReadString(machine->ReadRegister(4), filename, MaxFileNameLen);
+
+        int fd = -1;
+        OpenFile *openFile = fileSystem->Open(filename);
+        if (openFile != NULL) {
+            fd = currentThread->space->AllocateFd(openFile);
+            if (fd == -1)
+                delete openFile;        // open file table is full
+        }
+        DEBUG('a', "Open file %s as %d\n", filename, fd);
+        machine->WriteRegister(2, fd);
+        AdvancePC();
+    } else if ((which == SyscallException) && (type == SC_Read)) {
         int addr = machine->ReadRegister(4);
-        int i = 0;
-        do {
-            machine->ReadMem(addr + i, 1, (int *) &filename[i]);
-        } while (filename[i++] != '\0');
+        int size = machine->ReadRegister(5);
+        int fd = machine->ReadRegister(6);
+        int numRead = -1;
+        PipeBuffer *pipe = currentThread->space->GetPipe(fd, FALSE);
 
-        OpenFile *executable = fileSystem->Open(filename);
+        if (pipe != NULL) {
+            numRead = currentThread->space->PipeIO(pipe, addr, size, FALSE);
+        } else if (fd == ConsoleInput) {
+            // wait for at least one character, stop at end of line
+            StartConsole();
+            for (numRead = 0; numRead < size;) {
+                readAvail->P();
+                char ch = console->GetChar();
+                machine->WriteMem(addr + numRead++, 1, ch);
+                if (ch == '\n')
+                    break;
+            }
+        } else {
+            OpenFile *openFile = currentThread->space->GetFile(fd);
+            if (openFile != NULL)
+                numRead = currentThread->space->FileIO(openFile, addr, size, FALSE);
+        }
+        machine->WriteRegister(2, numRead);
+        AdvancePC();
+    } else if ((which == SyscallException) && (type == SC_Write)) {
+        int addr = machine->ReadRegister(4);
+        int size = machine->ReadRegister(5);
+        int fd = machine->ReadRegister(6);
+        PipeBuffer *pipe = currentThread->space->GetPipe(fd, TRUE);
 
-        if (executable == NULL) {
-            printf("Unable to open file %s\n", filename);
-            return;
+        if (pipe != NULL) {
+            currentThread->space->PipeIO(pipe, addr, size, TRUE);
+        } else if (fd == ConsoleOutput) {
+            int ch;
+            StartConsole();
+            for (int i = 0; i < size; i++) {
+                machine->ReadMem(addr + i, 1, &ch);
+                console->PutChar((char) ch);
+                writeDone->P();
+            }
+        } else {
+            OpenFile *openFile = currentThread->space->GetFile(fd);
+            if (openFile != NULL)
+                currentThread->space->FileIO(openFile, addr, size, TRUE);
         }
-        space = new AddrSpace(executable);
+        AdvancePC();
+    } else if ((which == SyscallException) &&
+               ((type == SC_ReadV) || (type == SC_WriteV))) {
+        int iovAddr = machine->ReadRegister(4);
+        int count = machine->ReadRegister(5);
+        int fd = machine->ReadRegister(6);
+        int result = -1;
 
-        delete executable;            // close file
+        OpenFile *openFile = currentThread->space->GetFile(fd);
+        if (openFile != NULL)
+            result = UserFileIOV(openFile, iovAddr, count, type == SC_WriteV);
+        DEBUG('a', "%s of %d buffers on file %d: %d bytes\n",
+              (type == SC_WriteV) ? "WriteV" : "ReadV", count, fd, result);
+        machine->WriteRegister(2, result);
+        AdvancePC();
+    } else if ((which == SyscallException) && (type == SC_RingSetup)) {
+        AddrSpace *space = currentThread->space;
+        int addr = machine->ReadRegister(4);
+        int result = -1;
+        int page;
 
-        Thread *thread = new Thread("executing new thread");
-        thread->Fork(StartProcess, 0);
-        currentThread->Yield();
+        // the ring must own RingPages whole pages, and only one per process
+        for (page = 0; page < RingPages; page++)
+            if (space->UserToPhys(addr + page * PageSize) == -1)
+                break;
+        if (space->ring == NULL && page == RingPages &&
+            (addr % PageSize) == 0) {
+            space->ring = new IoRing(space, addr);
+            result = 0;
+        }
+        DEBUG('a', "RingSetup at 0x%x: %d\n", addr, result);
+        machine->WriteRegister(2, result);
+        AdvancePC();
+    } else if ((which == SyscallException) && (type == SC_RingEnter)) {
+        IoRing *ring = currentThread->space->ring;
+        int minComplete = machine->ReadRegister(4);
 
-        machine->WriteRegister(2, space->getSpaceId());
+        machine->WriteRegister(2, (ring == NULL) ? -1 : ring->Enter(minComplete));
+        AdvancePC();
+    } else if ((which == SyscallException) && (type == SC_Pipe)) {
+        AddrSpace *space = currentThread->space;
+        int fdsAddr = machine->ReadRegister(4);
+        PipeBuffer *pipe = new PipeBuffer();
+        int readFd, writeFd = -1;
+        int result = -1;
+
+        if ((readFd = space->AllocatePipeFd(pipe, FALSE)) != -1 &&
+            (writeFd = space->AllocatePipeFd(pipe, TRUE)) != -1 &&
+            machine->WriteMem(fdsAddr, 4, readFd) &&
+            machine->WriteMem(fdsAddr + 4, 4, writeFd)) {
+            result = 0;
+        } else if (readFd == -1) {
+            delete pipe;                // no end ever opened
+        } else {
+            space->ReleaseFd(writeFd);  // the last close frees the pipe
+            space->ReleaseFd(readFd);
+        }
+        DEBUG('a', "Pipe: read end %d, write end %d\n", readFd, writeFd);
+        machine->WriteRegister(2, result);
+        AdvancePC();
+    } else if ((which == SyscallException) && (type == SC_GetClockPage)) {
+        machine->WriteRegister(2, currentThread->space->getClockAddr());
+        AdvancePC();
+    } else if ((which == SyscallException) && (type == SC_Close)) {
+        int fd = machine->ReadRegister(4);
 
+        DEBUG('a', "Close file %d\n", fd);
+        currentThread->space->ReleaseFd(fd);
         AdvancePC();
     } else {
         printf("Unexpected user mode exception %d %d\n", which, type);
@@ -103,6 +505,7 @@ ExceptionHandler(ExceptionType which) {
 }
 
 void AdvancePC() {
+    syscallTrace->End();                // the system call is done
     machine->WriteRegister(PrevPCReg, machine->ReadRegister(PCReg));
     machine->WriteRegister(PCReg, machine->ReadRegister(PCReg) + 4);
     machine->WriteRegister(NextPCReg, machine->ReadRegister(NextPCReg) + 4);
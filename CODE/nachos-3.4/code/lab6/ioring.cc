@@ -0,0 +1,206 @@
+// ioring.cc 
+//	Routines for the kernel side of asynchronous system call rings.
+//
+//	The user advances sqTail and cqHead; the kernel advances sqHead
+//	and cqTail.  Each index only ever grows, and a slot is the index
+//	modulo RingEntries, so "tail - head" is the number of entries in a
+//	queue.  Since Nachos runs on a uniprocessor and the user program
+//	can only run when no kernel code holds the CPU, the kernel never
+//	sees a half-updated index.
+//
+// Copyright (c) 1992-1993 The Regents of the University of California.
+// All rights reserved.  See copyright.h for copyright notice and limitation 
+// of liability and disclaimer of warranty provisions.
+
+#include "copyright.h"
+#include "system.h"
+#include "ioring.h"
+
+#define MaxRingNameLen 50    // longest program name for RingOpExec
+
+// dummy procedure because we can't take a pointer of a member function
+static void RingWorker(_int arg) { ((IoRing *) arg)->Work(); }
+
+//----------------------------------------------------------------------
+// IoRing::IoRing
+// 	Attach to a RingPage and fork the worker thread that services it.
+//
+//	"owner" -- the address space the ring belongs to
+//	"userAddr" -- where the (page aligned, mapped) RingPage is in it
+//----------------------------------------------------------------------
+
+IoRing::IoRing(AddrSpace *owner, int userAddr) {
+    ASSERT(RingCqOffset + RingEntries * RingCqeSize <= RingPages * PageSize);
+
+    space = owner;
+    base = userAddr;
+    exiting = FALSE;
+    inFlight = 0;
+    lock = new Lock("io ring lock");
+    submitted = new Condition("io ring submitted");
+    completed = new Condition("io ring completed");
+    consumed = new Condition("io ring consumed");
+
+    Thread *worker = new Thread("io ring worker");
+    worker->Fork(RingWorker, (_int) this);
+}
+
+//----------------------------------------------------------------------
+// IoRing::~IoRing
+// 	Only called by the worker thread itself, once told to Shutdown.
+//----------------------------------------------------------------------
+
+IoRing::~IoRing() {
+    delete consumed;
+    delete completed;
+    delete submitted;
+    delete lock;
+}
+
+//----------------------------------------------------------------------
+// IoRing::GetWord/PutWord
+// 	Access the RingPage, which is in the simulated machine's byte order.
+//	A word never straddles a page, so each is translated on its own.
+//----------------------------------------------------------------------
+
+int
+IoRing::GetWord(int offset) {
+    int physAddr = space->UserToPhys(base + offset);
+
+    return WordToHost(*(unsigned int *) &machine->mainMemory[physAddr]);
+}
+
+void
+IoRing::PutWord(int offset, int value) {
+    int physAddr = space->UserToPhys(base + offset);
+
+    *(unsigned int *) &machine->mainMemory[physAddr] = WordToMachine(value);
+}
+
+//----------------------------------------------------------------------
+// IoRing::Enter
+// 	Called on behalf of the user program by RingEnter.  Wake up the
+//	worker to look at the submission queue, then wait until at least
+//	"minComplete" completions are waiting to be consumed.  Never wait
+//	for more than are outstanding -- queued, being carried out, or
+//	already completed -- or for more than the completion queue holds.
+//
+//	Return the number of completions ready.
+//----------------------------------------------------------------------
+
+int
+IoRing::Enter(int minComplete) {
+    int ready, queued, outstanding;
+
+    lock->Acquire();
+    submitted->Signal(lock);
+    consumed->Signal(lock);
+    queued = GetWord(RingSqTail) - GetWord(RingSqHead);
+    if (queued < 0 || queued > RingEntries)
+        queued = 0;                    // the user garbled the indices
+    outstanding = queued + inFlight
+                  + GetWord(RingCqTail) - GetWord(RingCqHead);
+    if (minComplete > outstanding)
+        minComplete = outstanding;
+    if (minComplete > RingEntries)
+        minComplete = RingEntries;     // can never have more than that
+    while ((ready = GetWord(RingCqTail) - GetWord(RingCqHead)) < minComplete)
+        completed->Wait(lock);
+    lock->Release();
+    return ready;
+}
+
+//----------------------------------------------------------------------
+// IoRing::Shutdown
+// 	The owning address space is being deleted.  The worker may be
+//	asleep, so rather than deleting the ring under it, ask it to
+//	delete the ring and finish.
+//----------------------------------------------------------------------
+
+void
+IoRing::Shutdown() {
+    lock->Acquire();
+    exiting = TRUE;
+    submitted->Signal(lock);
+    consumed->Signal(lock);
+    lock->Release();
+}
+
+//----------------------------------------------------------------------
+// IoRing::Work
+// 	Worker thread.  Take submissions off the queue in order, carry
+//	each out (blocking on the disk if need be, while the user program
+//	keeps running), and post its completion.
+//----------------------------------------------------------------------
+
+void
+IoRing::Work() {
+    int head, slot, opcode, fd, buf, len, userData, result;
+
+    lock->Acquire();
+    for (;;) {
+        while (!exiting && GetWord(RingSqTail) == GetWord(RingSqHead))
+            submitted->Wait(lock);
+        if (exiting)
+            break;
+
+        head = GetWord(RingSqHead);
+        slot = RingSqOffset + (head % RingEntries) * RingSqeSize;
+        opcode = GetWord(slot);
+        fd = GetWord(slot + 4);
+        buf = GetWord(slot + 8);
+        len = GetWord(slot + 12);
+        userData = GetWord(slot + 16);
+        PutWord(RingSqHead, head + 1);   // slot is free for reuse
+        inFlight++;
+
+        lock->Release();
+        result = Execute(opcode, fd, buf, len);
+        lock->Acquire();
+
+        while (!exiting &&
+               GetWord(RingCqTail) - GetWord(RingCqHead) >= RingEntries)
+            consumed->Wait(lock);        // completion queue is full
+        if (exiting)
+            break;
+        slot = RingCqOffset + (GetWord(RingCqTail) % RingEntries) * RingCqeSize;
+        PutWord(slot, userData);
+        PutWord(slot + 4, result);
+        PutWord(RingCqTail, GetWord(RingCqTail) + 1);
+        inFlight--;
+        DEBUG('a', "Ring op %d on %d completed: %d\n", opcode, fd, result);
+        completed->Signal(lock);
+    }
+    lock->Release();
+    delete this;
+    currentThread->Finish();
+}
+
+//----------------------------------------------------------------------
+// IoRing::Execute
+// 	Do the work of one submission, as the matching synchronous system
+//	call would.  Return the value for the completion.
+//----------------------------------------------------------------------
+
+int
+IoRing::Execute(int opcode, int fd, int buf, int len) {
+    OpenFile *file;
+    char name[MaxRingNameLen];
+
+    switch (opcode) {
+        case RingOpRead:
+        case RingOpWrite:
+            if ((file = space->GetFile(fd)) == NULL || len < 0)
+                return -1;
+            return space->FileIO(file, buf, len, opcode == RingOpWrite);
+        case RingOpExec:
+            space->Copy(buf, name, MaxRingNameLen, FALSE);
+            name[MaxRingNameLen - 1] = '\0';
+            return ExecProgram(name, space);
+        case RingOpYield:
+            currentThread->Yield();
+            return 0;
+        default:
+            return -1;
+    }
+}
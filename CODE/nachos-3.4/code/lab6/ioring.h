@@ -0,0 +1,79 @@
+// ioring.h 
+//	Data structures for asynchronous system calls through a
+//	submission/completion ring shared between a user program and
+//	the kernel (cf. RingPage in syscall.h).
+//
+//	The ring lives in RingPages pages of the user's address space.  The
+//	kernel reaches it through the user's page table, so the pages need
+//	not be next to each other in physical memory.  The user
+//	fills in submissions and calls RingEnter; a kernel worker thread,
+//	one per ring, carries the requests out in the background and posts
+//	completions into the same page.  Because the worker is the one that
+//	blocks on the disk, a program can queue several requests and keep
+//	computing while they are serviced.
+//
+// Copyright (c) 1992-1993 The Regents of the University of California.
+// All rights reserved.  See copyright.h for copyright notice and limitation 
+// of liability and disclaimer of warranty provisions.
+
+#ifndef IORING_H
+#define IORING_H
+
+#include "copyright.h"
+#include "addrspace.h"
+#include "synch.h"
+#include "syscall.h"
+
+// Layout of a RingPage in user memory.  We can't use sizeof() on the
+// structures in syscall.h, since the host's pointers need not be the
+// same size as the MIPS ones.
+#define RingSqHead	0
+#define RingSqTail	4
+#define RingCqHead	8
+#define RingCqTail	12
+#define RingSqOffset	16
+#define RingSqeSize	20
+#define RingCqOffset	(RingSqOffset + RingEntries * RingSqeSize)
+#define RingCqeSize	8
+
+// The following class defines the kernel side of a ring.
+
+class IoRing {
+  public:
+    IoRing(AddrSpace *owner, int userAddr);	// Attach to the RingPage at
+					// "userAddr" in "owner", and start
+					// the worker thread
+    ~IoRing();
+
+    int Enter(int minComplete);		// Kick the worker, then wait for
+					// "minComplete" completions
+    void Shutdown();			// Owner is going away; tell the
+					// worker to free the ring and exit
+
+    void Work();			// Body of the worker thread
+
+  private:
+    AddrSpace *space;			// Address space that owns the ring
+    int base;				// User address of the RingPage
+    bool exiting;			// Set by Shutdown()
+    int inFlight;			// Submissions taken off the queue
+					// but not yet completed
+    Lock *lock;				// Protects the ring indices
+    Condition *submitted;		// Signalled by Enter
+    Condition *completed;		// Signalled when a completion is posted
+    Condition *consumed;		// Signalled when the user may have
+					// freed completion slots
+
+    int GetWord(int offset);		// Read/write a word of the RingPage
+    void PutWord(int offset, int value);
+    int Execute(int opcode, int fd, int buf, int len);
+					// Carry out one submission
+};
+
+extern int ExecProgram(char *filename, AddrSpace *parent,
+                       int input = ConsoleInput,
+                       int output = ConsoleOutput);
+					// Start a new user program
+					// Defined in exception.cc
+
+#endif // IORING_H
@@ -0,0 +1,124 @@
+// pipe.cc 
+//	Routines for kernel pipes.  The buffer is a ring: bytes live at
+//	buffer[head], ..., buffer[(head + count - 1) % PipeSize].
+//
+// Copyright (c) 1992-1993 The Regents of the University of California.
+// All rights reserved.  See copyright.h for copyright notice and limitation 
+// of liability and disclaimer of warranty provisions.
+
+#include "copyright.h"
+#include "system.h"
+#include "pipe.h"
+
+//----------------------------------------------------------------------
+// PipeBuffer::PipeBuffer
+// 	Initialize an empty pipe.  The caller opens the ends it needs.
+//----------------------------------------------------------------------
+
+PipeBuffer::PipeBuffer() {
+    head = count = 0;
+    readers = writers = 0;
+    lock = new Lock("pipe lock");
+    notEmpty = new Condition("pipe not empty");
+    notFull = new Condition("pipe not full");
+}
+
+PipeBuffer::~PipeBuffer() {
+    delete notFull;
+    delete notEmpty;
+    delete lock;
+}
+
+//----------------------------------------------------------------------
+// PipeBuffer::OpenEnd/CloseEnd
+// 	Keep track of how many reader and writer ends are open.  Closing
+//	the last writer wakes the readers so they can see end of file;
+//	closing the last reader wakes the writers so they can give up.
+//
+//	"writeEnd" -- TRUE for a writer end, FALSE for a reader end
+//----------------------------------------------------------------------
+
+void
+PipeBuffer::OpenEnd(bool writeEnd) {
+    lock->Acquire();
+    if (writeEnd)
+        writers++;
+    else
+        readers++;
+    lock->Release();
+}
+
+void
+PipeBuffer::CloseEnd(bool writeEnd) {
+    bool last;
+
+    lock->Acquire();
+    if (writeEnd) {
+        ASSERT(writers > 0);
+        if (--writers == 0)
+            notEmpty->Broadcast(lock);
+    } else {
+        ASSERT(readers > 0);
+        if (--readers == 0)
+            notFull->Broadcast(lock);
+    }
+    last = (readers == 0 && writers == 0);
+    lock->Release();
+    if (last)
+        delete this;
+}
+
+//----------------------------------------------------------------------
+// PipeBuffer::Read
+// 	Take up to "numBytes" bytes out of the pipe, as many as are
+//	buffered.  Return the number of bytes read; 0 means no data was
+//	available -- at end of file, or if we were told not to wait.
+//----------------------------------------------------------------------
+
+int
+PipeBuffer::Read(char *into, int numBytes, bool wait) {
+    int done = 0, chunk;
+
+    lock->Acquire();
+    while (wait && count == 0 && writers > 0)
+        notEmpty->Wait(lock);
+    while (done < numBytes && count > 0) {      // at most two pieces
+        chunk = min(numBytes - done, min(count, PipeSize - head));
+        bcopy(&buffer[head], &into[done], chunk);
+        head = (head + chunk) % PipeSize;
+        count -= chunk;
+        done += chunk;
+    }
+    if (done > 0)
+        notFull->Broadcast(lock);
+    lock->Release();
+    return done;
+}
+
+//----------------------------------------------------------------------
+// PipeBuffer::Write
+// 	Put "numBytes" bytes into the pipe, waiting for room as needed.
+//	Return the number of bytes written, which is short only if all
+//	the readers close their ends.
+//----------------------------------------------------------------------
+
+int
+PipeBuffer::Write(char *from, int numBytes) {
+    int done = 0, tail, chunk;
+
+    lock->Acquire();
+    while (done < numBytes && readers > 0) {
+        if (count == PipeSize) {
+            notFull->Wait(lock);
+            continue;
+        }
+        tail = (head + count) % PipeSize;
+        chunk = min(numBytes - done, min(PipeSize - count, PipeSize - tail));
+        bcopy(&from[done], &buffer[tail], chunk);
+        count += chunk;
+        done += chunk;
+        notEmpty->Broadcast(lock);
+    }
+    lock->Release();
+    return done;
+}
@@ -0,0 +1,56 @@
+// pipe.h 
+//	Data structures for kernel pipes -- a bounded buffer of bytes
+//	connecting the output of one user program to the input of another.
+//
+//	A pipe has any number of reader and writer ends open (an end is
+//	shared when a program is Exec'ed with it as its input or output).
+//	Reading from an empty pipe waits for data, or returns 0 (end of
+//	file) once every writer end is closed.  Writing to a full pipe
+//	waits for room.  The pipe is freed when the last end is closed.
+//
+// Copyright (c) 1992-1993 The Regents of the University of California.
+// All rights reserved.  See copyright.h for copyright notice and limitation 
+// of liability and disclaimer of warranty provisions.
+
+#ifndef PIPE_H
+#define PIPE_H
+
+#include "copyright.h"
+#include "synch.h"
+
+#define PipeSize	256	// bytes buffered in a pipe
+
+// The following class defines a pipe (named so as not to clash with
+// the Pipe system call in syscall.h).  Data is moved in as large a
+// batch as the buffer allows, and waiters are woken once per batch
+// rather than once per byte.
+
+class PipeBuffer {
+  public:
+    PipeBuffer();			// Create an empty pipe, with no ends
+					// open
+    ~PipeBuffer();
+
+    void OpenEnd(bool writeEnd);	// Count another reader/writer end
+    void CloseEnd(bool writeEnd);	// Release an end; the last one to go
+					// deletes the pipe
+
+    int Read(char *into, int numBytes, bool wait);
+					// Return up to "numBytes" bytes, 0
+					// at end of file.  If "wait", block
+					// until at least one byte arrives.
+    int Write(char *from, int numBytes);
+					// Write all "numBytes" bytes, unless
+					// every reader has gone away
+
+  private:
+    char buffer[PipeSize];		// the bytes in transit
+    int head;				// index of the oldest byte
+    int count;				// number of bytes buffered
+    int readers, writers;		// number of ends open
+    Lock *lock;				// protects all of the above
+    Condition *notEmpty;		// waited on by readers
+    Condition *notFull;			// waited on by writers
+};
+
+#endif // PIPE_H
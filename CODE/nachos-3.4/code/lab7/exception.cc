@@ -68,6 +68,9 @@ void
 ExceptionHandler(ExceptionType which) {
     int type = machine->ReadRegister(2);
 
+    if (which == SyscallException)
+        syscallTrace->Begin(type, currentThread->space->getSpaceId());
+
     if ((which == SyscallException) && (type == SC_Halt)) {
         DEBUG('a', "Shutdown, initiated by user program.\n");
         interrupt->Halt();
@@ -112,6 +115,7 @@ ExceptionHandler(ExceptionType which) {
 }
 
 void AdvancePC() {
+    syscallTrace->End();                // the system call is done
     machine->WriteRegister(PrevPCReg, machine->ReadRegister(PCReg));
     machine->WriteRegister(PCReg, machine->ReadRegister(PCReg) + 4);
     machine->WriteRegister(NextPCReg, machine->ReadRegister(NextPCReg) + 4);
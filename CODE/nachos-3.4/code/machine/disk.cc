@@ -7,6 +7,10 @@
 //	Disk operations are asynchronous, so we have to invoke an interrupt
 //	handler when the simulated operation completes.
 //
+//	The UNIX file is mapped into memory when the disk is created, so
+//	reading and writing sectors is a memory copy rather than a seek
+//	and a system call.
+//
 //  DO NOT CHANGE -- part of the machine emulation
 //
 // Copyright (c) 1992-1993 The Regents of the University of California.
@@ -20,10 +24,17 @@
 // We put this at the front of the UNIX file representing the
 // disk, to make it less likely we will accidentally treat a useful file 
 // as a disk (which would probably trash the file's contents).
-#define MagicNumber 	0x456789ab
-#define MagicSize 	sizeof(int)
+// The magic number is followed by the disk's geometry.  Disks made
+// before there was a geometry have the old magic number, and only
+// that in front of their sectors.
+#define MagicNumber 	0x456789ad
+#define OldMagicNumber 	0x456789ac
+#define HeaderSize 	((int) (4 * sizeof(int)))
+
+#define DiskSize 	(HeaderSize + (NumSectors * SectorSize))
 
-#define DiskSize 	(MagicSize + (NumSectors * SectorSize))
+int SectorsPerTrack = DefaultSectorsPerTrack;
+int NumTracks = DefaultNumTracks;
 
 // dummy procedure because we can't take a pointer of a member function
 static void DiskDone(_int arg) { ((Disk *)arg)->HandleInterrupt(); }
@@ -32,17 +43,26 @@ static void DiskDone(_int arg) { ((Disk *)arg)->HandleInterrupt(); }
 // Disk::Disk()
 // 	Initialize a simulated disk.  Open the UNIX file (creating it
 //	if it doesn't exist), and check the magic number to make sure it's 
-// 	ok to treat it as Nachos disk storage.
+// 	ok to treat it as Nachos disk storage.  The geometry comes from
+//	the file, or for a new disk, from the arguments (or the defaults).
+//	Then map the file into memory.
+//
+//	A disk made before the geometry was kept in the file is refused:
+//	its sectors start in a different place, so nothing on it can be
+//	used.  Remove it, and format a new one.
 //
 //	"name" -- text name of the file simulating the Nachos disk
 //	"callWhenDone" -- interrupt handler to be called when disk read/write
 //	   request completes
 //	"callArg" -- argument to pass the interrupt handler
+//	"numTracks", "sectorsPerTrack" -- the geometry wanted, or 0 to
+//	   take whatever the disk has
 //----------------------------------------------------------------------
 
-Disk::Disk(char* name, VoidFunctionPtr callWhenDone, _int callArg)
+Disk::Disk(char* name, VoidFunctionPtr callWhenDone, _int callArg,
+	   int numTracks, int sectorsPerTrack)
 {
-    int magicNum;
+    int header[4];		// magic, sector size, tracks, sectors/track
     int tmp = 0;
 
     DEBUG('d', "Initializing the disk, 0x%x 0x%x\n", callWhenDone, callArg);
@@ -50,34 +70,72 @@ Disk::Disk(char* name, VoidFunctionPtr callWhenDone, _int callArg)
     handlerArg = callArg;
     lastSector = 0;
     bufferInit = 0;
+    doneTag = activeTag = 0;
     
     fileno = OpenForReadWrite(name, FALSE);
     if (fileno >= 0) {		 	// file exists, check magic number 
-	Read(fileno, (char *) &magicNum, MagicSize);
-	ASSERT(magicNum == MagicNumber);
-    } else {				// file doesn't exist, create it
+	Read(fileno, (char *) header, HeaderSize);
+	if (header[0] == OldMagicNumber) {
+	    printf("%s is an old-format Nachos disk; remove it and "
+		   "format again (-f)\n", name);
+	    Exit(1);
+	}
+	ASSERT(header[0] == MagicNumber && header[1] == SectorSize);
+	if ((numTracks != 0 && numTracks != header[2])
+	    || (sectorsPerTrack != 0 && sectorsPerTrack != header[3])) {
+	    Close(fileno);		// different geometry: start over
+	    fileno = -1;
+	} else {
+	    NumTracks = header[2];
+	    SectorsPerTrack = header[3];
+	}
+    }
+    if (fileno < 0) {			// file doesn't exist, create it
+	NumTracks = (numTracks != 0) ? numTracks : DefaultNumTracks;
+	SectorsPerTrack = (sectorsPerTrack != 0) ? sectorsPerTrack
+						 : DefaultSectorsPerTrack;
+	ASSERT(NumTracks > 0 && SectorsPerTrack > 0);
         fileno = OpenForWrite(name);
-	magicNum = MagicNumber;  
-	WriteFile(fileno, (char *) &magicNum, MagicSize); // write magic number
+	header[0] = MagicNumber;
+	header[1] = SectorSize;
+	header[2] = NumTracks;
+	header[3] = SectorsPerTrack;
+	WriteFile(fileno, (char *) header, HeaderSize); // magic number, geometry
 
 	// need to write at end of file, so that reads will not return EOF
         Lseek(fileno, DiskSize - sizeof(int), 0);	
 	WriteFile(fileno, (char *)&tmp, sizeof(int));  
     }
+    image = MapFile(fileno, DiskSize);
     active = FALSE;
 }
 
 //----------------------------------------------------------------------
 // Disk::~Disk()
-// 	Clean up disk simulation, by closing the UNIX file representing the
-//	disk.
+// 	Clean up disk simulation, by syncing, unmapping and closing the
+//	UNIX file representing the disk.
 //----------------------------------------------------------------------
 
 Disk::~Disk()
 {
+    Sync();
+    UnmapFile(image, DiskSize);
     Close(fileno);
 }
 
+//----------------------------------------------------------------------
+// Disk::Sync()
+// 	Wait until every sector written so far has reached the UNIX file.
+//	Writes land in the mapped memory, which the host copies to the
+//	file whenever it likes; this forces the copy.
+//----------------------------------------------------------------------
+
+void
+Disk::Sync()
+{
+    SyncMappedFile(image, DiskSize);
+}
+
 //----------------------------------------------------------------------
 // Disk::PrintSector()
 // 	Dump the data in a disk read/write request, for debugging.
@@ -97,10 +155,18 @@ PrintSector (bool writing, int sector, char *data)
     printf("\n"); 
 }
 
+static void
+PrintSectors (bool writing, int sector, char *data, int count)
+{
+    for (int i = 0; i < count; i++)
+	PrintSector(writing, sector + i, data + i * SectorSize);
+}
+
 //----------------------------------------------------------------------
 // Disk::ReadRequest/WriteRequest
-// 	Simulate a request to read/write a single disk sector
-//	   Do the read/write immediately to the UNIX file
+// 	Simulate a request to read/write a run of disk sectors
+//	   Do the read/write immediately, by copying to or from the
+//	      mapped UNIX file
 //	   Set up an interrupt handler to be called later,
 //	      that will notify the caller when the simulator says
 //	      the operation has completed.
@@ -108,50 +174,64 @@ PrintSector (bool writing, int sector, char *data)
 //	Note that a disk only allows an entire sector to be read/written,
 //	not part of a sector.
 //
-//	"sectorNumber" -- the disk sector to read/write
+//	"sectorNumber" -- the first disk sector to read/write
 //	"data" -- the bytes to be written, the buffer to hold the incoming bytes
+//	"count" -- how many sectors to transfer
+//	"tag" -- handed back by DoneTag when the request completes
 //----------------------------------------------------------------------
 
 void
-Disk::ReadRequest(int sectorNumber, char* data)
+Disk::ReadRequest(int sectorNumber, char* data, int count, _int tag)
 {
-    int ticks = ComputeLatency(sectorNumber, FALSE);
+    int ticks = ComputeLatency(sectorNumber, FALSE, count);
 
     ASSERT(!active);				// only one request at a time
-    ASSERT((sectorNumber >= 0) && (sectorNumber < NumSectors));
-    
-    DEBUG('d', "Reading from sector %d\n", sectorNumber);
-    Lseek(fileno, SectorSize * sectorNumber + MagicSize, 0);
-    Read(fileno, data, SectorSize);
-    if (DebugIsEnabled('d'))
-	PrintSector(FALSE, sectorNumber, data);
-    
+    Transfer(sectorNumber, data, count, FALSE);
     active = TRUE;
-    UpdateLast(sectorNumber);
-    stats->numDiskReads++;
+    activeTag = tag;
+    UpdateLast(sectorNumber + count - 1);
     interrupt->Schedule(DiskDone, (_int) this, ticks, DiskInt);
 }
 
 void
-Disk::WriteRequest(int sectorNumber, char* data)
+Disk::WriteRequest(int sectorNumber, char* data, int count, _int tag)
 {
-    int ticks = ComputeLatency(sectorNumber, TRUE);
+    int ticks = ComputeLatency(sectorNumber, TRUE, count);
 
     ASSERT(!active);
-    ASSERT((sectorNumber >= 0) && (sectorNumber < NumSectors));
-    
-    DEBUG('d', "Writing to sector %d\n", sectorNumber);
-    Lseek(fileno, SectorSize * sectorNumber + MagicSize, 0);
-    WriteFile(fileno, data, SectorSize);
-    if (DebugIsEnabled('d'))
-	PrintSector(TRUE, sectorNumber, data);
-    
+    Transfer(sectorNumber, data, count, TRUE);
     active = TRUE;
-    UpdateLast(sectorNumber);
-    stats->numDiskWrites++;
+    activeTag = tag;
+    UpdateLast(sectorNumber + count - 1);
     interrupt->Schedule(DiskDone, (_int) this, ticks, DiskInt);
 }
 
+//----------------------------------------------------------------------
+// Disk::Transfer
+// 	Do the read/write part of a request, to or from the mapped UNIX
+//	file, and count it.
+//----------------------------------------------------------------------
+
+void
+Disk::Transfer(int sectorNumber, char* data, int count, bool writing)
+{
+    ASSERT((sectorNumber >= 0) && (count > 0)
+	   && (sectorNumber + count <= NumSectors));
+    if (writing) {
+	DEBUG('d', "Writing %d sectors to sector %d\n", count, sectorNumber);
+	bcopy(data, image + SectorSize * sectorNumber + HeaderSize,
+	      SectorSize * count);
+	stats->numDiskWrites++;
+    } else {
+	DEBUG('d', "Reading %d sectors from sector %d\n", count, sectorNumber);
+	bcopy(image + SectorSize * sectorNumber + HeaderSize, data,
+	      SectorSize * count);
+	stats->numDiskReads++;
+    }
+    if (DebugIsEnabled('d'))
+	PrintSectors(writing, sectorNumber, data, count);
+}
+
 //----------------------------------------------------------------------
 // Disk::HandleInterrupt()
 // 	Called when it is time to invoke the disk interrupt handler,
@@ -162,6 +242,7 @@ void
 Disk::HandleInterrupt ()
 { 
     active = FALSE;
+    doneTag = activeTag;
     (*handler)(handlerArg);
 }
 
@@ -210,8 +291,8 @@ Disk::ModuloDiff(int to, int from)
 
 //----------------------------------------------------------------------
 // Disk::ComputeLatency()
-// 	Return how long will it take to read/write a disk sector, from
-//	the current position of the disk head.
+// 	Return how long will it take to read/write "count" disk sectors
+//	starting at "newSector", from the current position of the disk head.
 //
 //   	Latency = seek time + rotational latency + transfer time
 //   	Disk seeks at one track per SeekTime ticks (cf. stats.h)
@@ -227,29 +308,36 @@ Disk::ModuloDiff(int to, int from)
 //   	read requests to the current track to be satisfied more quickly.
 //   	The contents of the track buffer are discarded after every seek to 
 //   	a new track.
+//
+//	Once the first sector of a run is reached, the rest follow it
+//	under the head: one more RotationTime each, plus a one track seek
+//	wherever the run moves onto the next track.
 //----------------------------------------------------------------------
 
 int
-Disk::ComputeLatency(int newSector, bool writing)
+Disk::ComputeLatency(int newSector, bool writing, int count)
 {
     int rotation;
     int seek = TimeToSeek(newSector, &rotation);
     int timeAfter = stats->totalTicks + seek + rotation;
+    int rest = (count - 1) * RotationTime
+	+ ((newSector + count - 1) / SectorsPerTrack
+	   - newSector / SectorsPerTrack) * SeekTime;
 
 #ifndef NOTRACKBUF	// turn this on if you don't want the track buffer stuff
     // check if track buffer applies
     if ((writing == FALSE) && (seek == 0) 
 		&& (((timeAfter - bufferInit) / RotationTime) 
 	     		> ModuloDiff(newSector, bufferInit / RotationTime))) {
-        DEBUG('d', "Request latency = %d\n", RotationTime);
-	return RotationTime; // time to transfer sector from the track buffer
+        DEBUG('d', "Request latency = %d\n", RotationTime + rest);
+	return RotationTime + rest; // first sector from the track buffer
     }
 #endif
 
     rotation += ModuloDiff(newSector, timeAfter / RotationTime) * RotationTime;
 
-    DEBUG('d', "Request latency = %d\n", seek + rotation + RotationTime);
-    return(seek + rotation + RotationTime);
+    DEBUG('d', "Request latency = %d\n", seek + rotation + RotationTime + rest);
+    return(seek + rotation + RotationTime + rest);
 }
 
 //----------------------------------------------------------------------
@@ -33,6 +33,9 @@
 // and an interrupt is invoked later to signal that the operation completed.
 //
 // The physical disk is in fact simulated via operations on a UNIX file.
+// The file is mapped into memory, so a transfer is just a copy; the
+// host writes the changes back to the file at its leisure, and Sync
+// (or deleting the disk) makes sure they are there.
 //
 // To make life a little more realistic, the simulated time for
 // each operation reflects a "track buffer" -- RAM to store the contents
@@ -45,42 +48,89 @@
 // disks these days now come with a track buffer.
 //
 // The track buffer simulation can be disabled by compiling with -DNOTRACKBUF
+//
+// Other kinds of storage device (see flashdisk.h) derive from Disk,
+// keeping its interface and its UNIX file, but replacing the timing.
+// Such a device may take several requests at once (Channels), and
+// complete them in any order; each request carries a tag, and while
+// the interrupt handler runs, DoneTag says which request finished.
+//
+// A request can also cover a run of consecutive sectors.  The head seeks
+// once, then the sectors pass under it one after the other, so the run
+// costs one seek plus one transfer time per sector (plus a track-to-track
+// step wherever it crosses onto the next track), and only one interrupt.
+
+#ifndef SectorSize
+#define SectorSize 		128	// number of bytes per disk sector;
+#endif					// build with -DSectorSize=n to change
+
+#define DefaultSectorsPerTrack 	32	// geometry of a new disk, unless
+#define DefaultNumTracks 	32	// told otherwise
 
-#define SectorSize 		128	// number of bytes per disk sector
-#define SectorsPerTrack 	32	// number of sectors per disk track 
-#define NumTracks 		32	// number of tracks per disk
+// The rest of the geometry is chosen when the disk is created (that
+// is, when it is formatted), and recorded at the front of the UNIX file
+// along with the sector size; opening the disk again reads it back from
+// there.  It doesn't change while Nachos is running.
+
+extern int SectorsPerTrack;		// number of sectors per disk track 
+extern int NumTracks;			// number of tracks per disk
 #define NumSectors 		(SectorsPerTrack * NumTracks)
 					// total # of sectors per disk
 
 class Disk {
   public:
-    Disk(char* name, VoidFunctionPtr callWhenDone, _int callArg);
+    Disk(char* name, VoidFunctionPtr callWhenDone, _int callArg,
+	 int numTracks = 0, int sectorsPerTrack = 0);
     					// Create a simulated disk.  
 					// Invoke (*callWhenDone)(callArg) 
 					// every time a request completes.
-    ~Disk();				// Deallocate the disk.
+					// A non-zero geometry that differs
+					// from the UNIX file's starts a new,
+					// empty disk.
+    virtual ~Disk();			// Deallocate the disk, after
+					// syncing it
     
-    void ReadRequest(int sectorNumber, char* data);
-    					// Read/write an single disk sector.
+    virtual void ReadRequest(int sectorNumber, char* data, int count = 1,
+			     _int tag = 0);
+    					// Read/write "count" consecutive disk
+					// sectors, starting at sectorNumber.
 					// These routines send a request to 
     					// the disk and return immediately.
     					// Only one request allowed at a time!
-    void WriteRequest(int sectorNumber, char* data);
+    virtual void WriteRequest(int sectorNumber, char* data, int count = 1,
+			      _int tag = 0);
+
+    virtual int Channels() { return 1; }
+					// How many requests may be in
+					// progress at once
+    _int DoneTag() { return doneTag; }	// Tag of the request just finished
+
+    void Sync();			// Make sure everything written so
+					// far is in the UNIX file
 
     void HandleInterrupt();		// Interrupt handler, invoked when
 					// disk request finishes.
 
-    int ComputeLatency(int newSector, bool writing);	
+    int ComputeLatency(int newSector, bool writing, int count = 1);
     					// Return how long a request to 
 					// newSector will take: 
 					// (seek + rotational delay + transfer)
 
-  private:
-    int fileno;				// UNIX file number for simulated disk 
+  protected:
+    void Transfer(int sectorNumber, char* data, int count, bool writing);
+					// Move the data of a request to or
+					// from the UNIX file
+
     VoidFunctionPtr handler;		// Interrupt handler, to be invoked 
 					// when any disk request finishes
     _int handlerArg;			// Argument to interrupt handler 
+    _int doneTag;			// Tag of the request that finished
+
+  private:
+    int fileno;				// UNIX file number for simulated disk 
+    char *image;			// The UNIX file, mapped into memory
     bool active;     			// Is a disk operation in progress?
+    _int activeTag;			// ... and if so, its tag
     int lastSector;			// The previous disk request 
     int bufferInit;			// When the track buffer started 
 					// being loaded
@@ -0,0 +1,280 @@
+// flashdisk.cc
+//	Routines to simulate a flash storage device.  The data itself is
+//	kept by the Disk routines, in the UNIX file; this only works out
+//	how long each request takes, by keeping track of which page holds
+//	each sector and of what each channel is doing.
+//
+//	See flashdisk.h for how the device behaves.
+//
+// Copyright (c) 1992-1993 The Regents of the University of California.
+// All rights reserved.  See copyright.h for copyright notice and limitation
+// of liability and disclaimer of warranty provisions.
+
+#include "copyright.h"
+#include "flashdisk.h"
+#include "system.h"
+
+// A request in progress, waiting for its interrupt.
+
+class FlashRequest {
+  public:
+    FlashDisk *disk;
+    _int tag;				// to hand back through DoneTag
+};
+
+// dummy procedure because we can't take a pointer of a member function
+static void
+FlashDone(_int arg)
+{
+    FlashRequest *request = (FlashRequest *) arg;
+
+    request->disk->RequestDone(request);
+}
+
+//----------------------------------------------------------------------
+// FlashDisk::FlashDisk
+// 	Initialize a simulated flash device.  The UNIX file is handled as
+//	for a Disk; all the flash is erased.
+//
+//	Each channel gets enough blocks to hold its share of the sectors,
+//	plus spare ones (see FlashSpare), plus two: one being filled, and
+//	one kept erased for garbage collection to copy into.
+//
+//	"name", "callWhenDone", "callArg", "numTracks", "sectorsPerTrack" --
+//	   as for Disk::Disk
+//	"channels" -- how many requests the device can work on at once
+//----------------------------------------------------------------------
+
+FlashDisk::FlashDisk(char* name, VoidFunctionPtr callWhenDone, _int callArg,
+		     int channels, int numTracks, int sectorsPerTrack)
+	: Disk(name, callWhenDone, callArg, numTracks, sectorsPerTrack)
+{
+    int dataBlocks, numBlocks, i;
+
+    ASSERT(channels > 0);
+    numChannels = channels;
+    dataBlocks = divRoundUp(divRoundUp(NumSectors, numChannels),
+			    PagesPerBlock);
+    blocksPerChannel = dataBlocks + divRoundUp(dataBlocks, FlashSpare) + 2;
+    numBlocks = blocksPerChannel * numChannels;
+    DEBUG('d', "Flash: %d channels of %d blocks\n", numChannels,
+	  blocksPerChannel);
+
+    numRequests = 0;
+    busyUntil = new int[numChannels];
+    numErased = new int[numChannels];
+    nextPage = new int[numChannels];
+    for (i = 0; i < numChannels; i++) {
+	busyUntil[i] = 0;
+	numErased[i] = blocksPerChannel;
+	nextPage[i] = -1;
+    }
+    map = new int[NumSectors];
+    for (i = 0; i < NumSectors; i++)
+	map[i] = -1;
+    owner = new int[numBlocks * PagesPerBlock];
+    for (i = 0; i < numBlocks * PagesPerBlock; i++)
+	owner[i] = -1;
+    livePages = new int[numBlocks];
+    erased = new bool[numBlocks];
+    for (i = 0; i < numBlocks; i++) {
+	livePages[i] = 0;
+	erased[i] = TRUE;
+    }
+}
+
+//----------------------------------------------------------------------
+// FlashDisk::~FlashDisk
+// 	Throw away the flash bookkeeping; Disk::~Disk does the rest.
+//----------------------------------------------------------------------
+
+FlashDisk::~FlashDisk()
+{
+    ASSERT(numRequests == 0);
+    delete [] busyUntil;
+    delete [] numErased;
+    delete [] nextPage;
+    delete [] map;
+    delete [] owner;
+    delete [] livePages;
+    delete [] erased;
+}
+
+//----------------------------------------------------------------------
+// FlashDisk::ReadRequest/WriteRequest
+// 	Simulate a request to read/write a run of sectors.  The data is
+//	moved right away; each sector is then read or programmed by its
+//	own channel, and the interrupt comes when the last of them is
+//	done.  A channel that is already busy gets to the sector once it
+//	has finished what it is doing.
+//
+//	"sectorNumber" -- the first sector to read/write
+//	"data" -- the bytes to be written, the buffer to hold the incoming bytes
+//	"count" -- how many sectors to transfer
+//	"tag" -- handed back by DoneTag when the request completes
+//----------------------------------------------------------------------
+
+void
+FlashDisk::ReadRequest(int sectorNumber, char* data, int count, _int tag)
+{
+    FlashRequest *request = new FlashRequest;
+    int done = 0;
+
+    ASSERT(numRequests < numChannels);
+    Transfer(sectorNumber, data, count, FALSE);
+    for (int i = 0; i < count; i++)
+	done = max(done, Busy((sectorNumber + i) % numChannels,
+			      FlashReadTime));
+
+    numRequests++;
+    request->disk = this;
+    request->tag = tag;
+    interrupt->Schedule(FlashDone, (_int) request, done - stats->totalTicks,
+			DiskInt);
+}
+
+void
+FlashDisk::WriteRequest(int sectorNumber, char* data, int count, _int tag)
+{
+    FlashRequest *request = new FlashRequest;
+    int done = 0;
+
+    ASSERT(numRequests < numChannels);
+    Transfer(sectorNumber, data, count, TRUE);
+    for (int i = 0; i < count; i++)
+	done = max(done, Program(sectorNumber + i));
+
+    numRequests++;
+    request->disk = this;
+    request->tag = tag;
+    interrupt->Schedule(FlashDone, (_int) request, done - stats->totalTicks,
+			DiskInt);
+}
+
+//----------------------------------------------------------------------
+// FlashDisk::RequestDone
+// 	Called when it is time to invoke the disk interrupt handler, to
+//	tell the Nachos kernel that a request is done.
+//----------------------------------------------------------------------
+
+void
+FlashDisk::RequestDone(FlashRequest *request)
+{
+    numRequests--;
+    doneTag = request->tag;
+    delete request;
+    (*handler)(handlerArg);
+}
+
+//----------------------------------------------------------------------
+// FlashDisk::Busy
+// 	Give a channel "ticks" more work, starting once it has finished
+//	what it has already; return the time it will be done.
+//----------------------------------------------------------------------
+
+int
+FlashDisk::Busy(int channel, int ticks)
+{
+    busyUntil[channel] = max(busyUntil[channel], stats->totalTicks) + ticks;
+    return busyUntil[channel];
+}
+
+//----------------------------------------------------------------------
+// FlashDisk::Program
+// 	Write "sector" to a fresh page of its channel, leaving the page
+//	it was in before (if any) stale.  Return when the channel will be
+//	done, garbage collection included.
+//----------------------------------------------------------------------
+
+int
+FlashDisk::Program(int sector)
+{
+    int channel = sector % numChannels;
+    int page;
+
+    if (map[sector] != -1) {
+	owner[map[sector]] = -1;
+	livePages[map[sector] / PagesPerBlock]--;
+    }
+    page = NewPage(channel, FALSE);
+    owner[page] = sector;
+    map[sector] = page;
+    livePages[page / PagesPerBlock]++;
+    return Busy(channel, FlashProgramTime);
+}
+
+//----------------------------------------------------------------------
+// FlashDisk::NewPage
+// 	Return the next erased page of a channel, to be programmed.  Pages
+//	are used in order through a block; when the block is full, the
+//	channel moves on to another erased block -- garbage collecting
+//	first, if that would leave none erased for garbage collection to
+//	use.
+//
+//	"collecting" -- are we being called by garbage collection?
+//----------------------------------------------------------------------
+
+int
+FlashDisk::NewPage(int channel, bool collecting)
+{
+    int block, page;
+
+    while (nextPage[channel] == -1) {
+	if (numErased[channel] <= 1 && !collecting) {
+	    Collect(channel);		// may start a block of its own
+	    continue;
+	}
+	ASSERT(numErased[channel] > 0);
+	for (block = channel; !erased[block]; block += numChannels)
+	    ;
+	erased[block] = FALSE;
+	numErased[channel]--;
+	nextPage[channel] = block * PagesPerBlock;
+    }
+    page = nextPage[channel]++;
+    if (nextPage[channel] % PagesPerBlock == 0)
+	nextPage[channel] = -1;		// block full
+    return page;
+}
+
+//----------------------------------------------------------------------
+// FlashDisk::Collect
+// 	Erase a block of a channel, to make room.  The block with the
+//	fewest live pages is chosen, and they are copied to fresh pages
+//	first.  Called when the channel has no block being filled, so
+//	there are more than enough sectors' worth of other blocks for
+//	some block to have a stale page.
+//----------------------------------------------------------------------
+
+void
+FlashDisk::Collect(int channel)
+{
+    int victim = -1, block, page, sector, i;
+
+    for (block = channel; block < blocksPerChannel * numChannels;
+	 block += numChannels)
+	if (!erased[block]
+	    && (victim == -1 || livePages[block] < livePages[victim]))
+	    victim = block;
+    ASSERT(victim != -1 && livePages[victim] < PagesPerBlock);
+    DEBUG('d', "Flash: collecting block %d, %d live pages\n", victim,
+	  livePages[victim]);
+
+    for (i = victim * PagesPerBlock; i < (victim + 1) * PagesPerBlock; i++) {
+	sector = owner[i];
+	if (sector == -1)
+	    continue;
+	page = NewPage(channel, TRUE);
+	owner[page] = sector;
+	map[sector] = page;
+	livePages[page / PagesPerBlock]++;
+	owner[i] = -1;
+	Busy(channel, FlashReadTime + FlashProgramTime);
+	stats->numFlashMoves++;
+    }
+    livePages[victim] = 0;
+    erased[victim] = TRUE;
+    numErased[channel]++;
+    Busy(channel, FlashEraseTime);
+    stats->numFlashErases++;
+}
@@ -0,0 +1,85 @@
+// flashdisk.h
+//	Data structures to emulate a flash storage device (an SSD), as an
+//	alternative to the rotating disk.  It has the same interface as
+//	the Disk, and keeps its data in the same kind of UNIX file, so
+//	either one can be used on the same disk image.
+//
+//	What differs is the timing.  There is no seek or rotation; instead
+//	the device has several channels, each with its own flash chips,
+//	which work on requests at the same time.  Flash is read and
+//	programmed (written) a page -- a sector -- at a time, but a page
+//	can only be programmed once between erasures, and erasing is done
+//	a whole block of pages at a time, and is slow.
+//
+//	So, as in a real SSD, a sector isn't rewritten in place: each write
+//	programs a fresh page, and the mapping from sector to page is
+//	updated, leaving the old page stale.  When a channel runs short
+//	of erased blocks, it garbage collects: it picks the block with the
+//	fewest live pages, copies those elsewhere, and erases the block.
+//	That work delays whatever the channel does next.
+//
+//	Sector i belongs to channel i % numChannels, so consecutive
+//	sectors are spread over all the channels.  The mapping is only
+//	kept in memory; when Nachos starts, no sector has a page yet.
+//
+// Copyright (c) 1992-1993 The Regents of the University of California.
+// All rights reserved.  See copyright.h for copyright notice and limitation
+// of liability and disclaimer of warranty provisions.
+
+#ifndef FLASHDISK_H
+#define FLASHDISK_H
+
+#include "copyright.h"
+#include "disk.h"
+
+#define PagesPerBlock 	32	// pages erased together
+#define FlashSpare 	4	// one block in this many is spare, so
+				// garbage collection has room to work
+
+class FlashRequest;
+
+class FlashDisk : public Disk {
+  public:
+    FlashDisk(char* name, VoidFunctionPtr callWhenDone, _int callArg,
+	      int channels, int numTracks = 0, int sectorsPerTrack = 0);
+    					// Create a simulated flash device,
+					// with "channels" channels
+    ~FlashDisk();
+
+    void ReadRequest(int sectorNumber, char* data, int count = 1,
+		     _int tag = 0);
+    void WriteRequest(int sectorNumber, char* data, int count = 1,
+		      _int tag = 0);
+    					// Read/write consecutive sectors;
+					// up to numChannels requests may
+					// be in progress at once
+    int Channels() { return numChannels; }
+
+    void RequestDone(FlashRequest *request);
+    					// Interrupt handler, invoked when
+					// a request finishes
+
+  private:
+    int Busy(int channel, int ticks);	// Keep a channel busy for "ticks"
+					// more, and return when it is free
+    int Program(int sector);		// Write a sector to a fresh page
+    int NewPage(int channel, bool collecting);
+    					// Find a fresh page to program
+    void Collect(int channel);		// Garbage collect one block
+
+    int numChannels;
+    int blocksPerChannel;		// Blocks of each channel; block b
+					// belongs to channel b % numChannels
+    int numRequests;			// Requests in progress
+    int *busyUntil;			// When each channel is next free
+    int *map;				// Page holding each sector, or -1
+    int *owner;				// Sector each page holds, or -1 if
+					// it is erased or stale
+    int *livePages;			// Pages in use, in each block
+    bool *erased;			// Is each block erased?
+    int *numErased;			// Erased blocks on each channel
+    int *nextPage;			// Next page each channel programs,
+					// or -1 if it needs a new block
+};
+
+#endif // FLASHDISK_H
@@ -161,6 +161,10 @@ Interrupt::OneTick()
 	stats->userTicks += UserTick;
     }
     DEBUG('i', "\n== Tick %d ==\n", stats->totalTicks);
+#ifdef USER_PROGRAM
+    if (machine != NULL)
+	machine->UpdateClockPage();	// keep the user-readable clock current
+#endif
 
 // check any pending interrupts are now ready to fire
     ChangeLevel(IntOn, IntOff);		// first, turn off interrupts
@@ -242,6 +246,9 @@ Interrupt::Halt()
 {
     printf("Machine halting!\n\n");
     stats->Print();
+#ifdef USER_PROGRAM
+    syscallTrace->Print();
+#endif
     Cleanup();     // Never returns.
 }
 
@@ -71,6 +71,7 @@ Machine::Machine(bool debug)
     pageTable = NULL;
 #endif
 
+    clockFrame = -1;
     singleStep = debug;
     CheckEndian();
 }
@@ -87,6 +88,23 @@ Machine::~Machine()
         delete [] tlb;
 }
 
+//----------------------------------------------------------------------
+// Machine::UpdateClockPage
+// 	Copy the simulated time into the clock page, if the kernel has
+//	set one up.  Called on every tick, so the cost is two stores.
+//----------------------------------------------------------------------
+
+void
+Machine::UpdateClockPage()
+{
+    if (clockFrame < 0)
+	return;
+    char *page = &mainMemory[clockFrame * PageSize];
+
+    *(unsigned int *) &page[ClockTotalTicks] = WordToMachine(stats->totalTicks);
+    *(unsigned int *) &page[ClockUserTicks] = WordToMachine(stats->userTicks);
+}
+
 //----------------------------------------------------------------------
 // Machine::RaiseException
 // 	Transfer control to the Nachos kernel from user mode, because
@@ -182,6 +182,14 @@ class Machine {
     TranslationEntry *pageTable;
     unsigned int pageTableSize;
 
+// A page of physical memory can be set aside as a clock that user
+// programs read with ordinary loads, instead of trapping to the kernel
+// (the page is mapped read-only into every address space).  The
+// simulated time in it is kept current on every tick.
+
+    int clockFrame;		// physical page of the clock, -1 if none
+    void UpdateClockPage();	// Copy the current time into the clock
+
   private:
     bool singleStep;		// drop back into the debugger after each
 				// simulated instruction
@@ -189,6 +197,11 @@ class Machine {
 				// time reaches this value
 };
 
+// Layout of the clock page (cf. ClockPage in syscall.h), as byte offsets
+#define ClockTotalTicks		0	// stats->totalTicks
+#define ClockUserTicks		4	// stats->userTicks
+#define ClockSpaceId		8	// SpaceId of the running program
+
 extern void ExceptionHandler(ExceptionType which);
 				// Entry point into Nachos for handling
 				// user system calls and exceptions
@@ -20,8 +20,13 @@ Statistics::Statistics()
 {
     totalTicks = idleTicks = systemTicks = userTicks = 0;
     numDiskReads = numDiskWrites = 0;
+    diskSeekTracks = diskQueueTotal = diskQueueMax = 0;
+    numFlashErases = numFlashMoves = 0;
     numConsoleCharsRead = numConsoleCharsWritten = 0;
     numPageFaults = numPacketsSent = numPacketsRecvd = 0;
+    numCacheHits = numCacheMisses = numReadAheads = 0;
+    numJournalCommits = numJournalSectors = numCheckpoints = 0;
+    numSegmentsWritten = numSegmentsCleaned = numCleanerMoves = 0;
 }
 
 //----------------------------------------------------------------------
@@ -35,10 +40,27 @@ Statistics::Print()
 {
     printf("Ticks: total %d, idle %d, system %d, user %d\n", totalTicks, 
 	idleTicks, systemTicks, userTicks);
+    int numDiskRequests = numDiskReads + numDiskWrites;
+
     printf("Disk I/O: reads %d, writes %d\n", numDiskReads, numDiskWrites);
+    if (numDiskRequests > 0)
+	printf("Disk queue: average seek %.2f tracks, average depth %.2f, "
+	    "max depth %d\n", (double) diskSeekTracks / numDiskRequests,
+	    (double) diskQueueTotal / numDiskRequests, diskQueueMax);
+    if (numFlashErases > 0 || numFlashMoves > 0)
+	printf("Flash: blocks erased %d, pages moved %d\n", numFlashErases,
+	    numFlashMoves);
     printf("Console I/O: reads %d, writes %d\n", numConsoleCharsRead, 
 	numConsoleCharsWritten);
     printf("Paging: faults %d\n", numPageFaults);
+    printf("Buffer cache: hits %d, misses %d, read ahead %d\n", numCacheHits,
+	numCacheMisses, numReadAheads);
+    if (numJournalCommits > 0)
+	printf("Journal: commits %d, sectors logged %d, checkpoints %d\n",
+	    numJournalCommits, numJournalSectors, numCheckpoints);
+    if (numSegmentsWritten > 0 || numSegmentsCleaned > 0)
+	printf("Log: segments written %d, cleaned %d, sectors moved %d\n",
+	    numSegmentsWritten, numSegmentsCleaned, numCleanerMoves);
     printf("Network I/O: packets received %d, sent %d\n", numPacketsRecvd, 
 	numPacketsSent);
 }
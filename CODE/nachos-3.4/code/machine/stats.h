@@ -30,9 +30,24 @@ class Statistics {
 
     int numDiskReads;		// number of disk read requests
     int numDiskWrites;		// number of disk write requests
+    int diskSeekTracks;		// tracks the head moved between requests
+    int diskQueueTotal;		// sum of the queue lengths requests found
+    int diskQueueMax;		// longest the disk queue got
+    int numFlashErases;		// number of flash blocks erased
+    int numFlashMoves;		// number of live flash pages copied by
+				// garbage collection
     int numConsoleCharsRead;	// number of characters read from the keyboard
     int numConsoleCharsWritten; // number of characters written to the display
     int numPageFaults;		// number of virtual memory page faults
+    int numCacheHits;		// number of sector accesses served from,
+    int numCacheMisses;		// ... or not found in, the buffer cache
+    int numReadAheads;		// number of sectors prefetched into it
+    int numJournalCommits;	// number of metadata transactions committed,
+    int numJournalSectors;	// ... the sectors logged in them,
+    int numCheckpoints;		// ... and times they were written home
+    int numSegmentsWritten;	// number of full log segments written,
+    int numSegmentsCleaned;	// ... segments freed by the cleaner,
+    int numCleanerMoves;	// ... and live sectors it copied
     int numPacketsSent;		// number of packets sent over the network
     int numPacketsRecvd;	// number of packets received over the network
 
@@ -53,6 +68,9 @@ class Statistics {
 #define SystemTick 	10 	// advance each time interrupts are enabled
 #define RotationTime 	500 	// time disk takes to rotate one sector
 #define SeekTime 	500    	// time disk takes to seek past one track
+#define FlashReadTime 	50	// time flash takes to read one page,
+#define FlashProgramTime 200	// ... to write (program) one page,
+#define FlashEraseTime 	1500	// ... and to erase one block
 #define ConsoleTime 	100	// time to read or write one character
 #define NetworkTime 	100   	// time to send or receive one packet
 #define TimerTicks 	100    	// (average) time between timer interrupts
@@ -30,6 +30,12 @@ extern void Close(int fd);
 //extern bool Unlink(char *name);
 extern int Unlink(char *name);
 
+// Map the first "size" bytes of an open file into memory, shared, so
+// that stores into the memory change the file
+extern char *MapFile(int fd, int size);
+extern void SyncMappedFile(char *addr, int size);
+extern void UnmapFile(char *addr, int size);
+
 // Interprocess communication operations, for simulating the network
 extern int OpenSocket();
 extern void CloseSocket(int sockID);
@@ -44,6 +50,9 @@ extern void Abort();
 extern void Exit(int exitCode);
 extern void Delay(int seconds);
 
+// Host wall clock time in seconds, for measuring the simulation itself
+extern double HostTime();
+
 // Initialize system so that cleanUp routine is called when user hits ctl-C
 extern void CallOnUserAbort(VoidNoArgFunctionPtr cleanUp);
 
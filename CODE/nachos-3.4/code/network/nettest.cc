@@ -63,5 +63,8 @@ MailTest(int farAddr)
     fflush(stdout);
 
     // Then we're done!
+#ifdef FILESYS
+    fileSystem->Sync();			// Halt can't wait for the disk
+#endif
     interrupt->Halt();
 }
@@ -0,0 +1,50 @@
+/* fileio.c
+ *	Test program for the file system calls: Create, Open, Write,
+ *	Read and Close.
+ *
+ *	Write a file, then read it back through a new OpenFileId, checking
+ *	the byte counts and the contents.  Exits with 0 if all is well,
+ *	or with the number of the check that failed.
+ */
+
+#include "syscall.h"
+
+#define SIZE	300		/* more than two sectors */
+
+char out[SIZE], in[SIZE + 10];
+
+int
+main()
+{
+    OpenFileId fd;
+    int i, n;
+
+    for (i = 0; i < SIZE; i++)
+	out[i] = 'a' + i % 26;
+
+    Create("fileio.tmp");
+    fd = Open("fileio.tmp");
+    if (fd < 0)
+	Exit(1);
+    Write(out, SIZE, fd);
+    Close(fd);
+
+    fd = Open("fileio.tmp");
+    if (fd < 0)
+	Exit(2);
+    n = Read(in, SIZE + 10, fd);	/* ask for more than there is */
+    if (n != SIZE)
+	Exit(3);
+    for (i = 0; i < SIZE; i++)
+	if (in[i] != out[i])
+	    Exit(4);
+    if (Read(in, 1, fd) != 0)		/* at the end of the file */
+	Exit(5);
+    Close(fd);
+
+    if (Read(in, 1, fd) != -1)		/* no longer open */
+	Exit(6);
+    if (Open("fileio.none") != -1)
+	Exit(7);
+    Exit(0);
+}
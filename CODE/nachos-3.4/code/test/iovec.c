@@ -0,0 +1,73 @@
+/* iovec.c
+ *	Test program for the ReadV and WriteV system calls.
+ *
+ *	Gather three buffers (one of them empty) into a file, then a
+ *	vector whose second buffer is not in the address space, which
+ *	should stop after the first.  Read it all back, scattered over
+ *	buffers of different sizes, and check the byte counts and the
+ *	contents.  Exits with 0 if all is well, or with the number of the
+ *	check that failed.
+ */
+
+#include "syscall.h"
+
+char a[5], b[200], c[10];		/* written */
+char x[100], y[150];			/* read back */
+
+IoVec iov[3];
+
+int
+main()
+{
+    OpenFileId fd;
+    int i, n;
+
+    for (i = 0; i < 5; i++)
+	a[i] = 'A' + i;
+    for (i = 0; i < 200; i++)
+	b[i] = 'a' + i % 26;
+    for (i = 0; i < 10; i++)
+	c[i] = '0' + i;
+
+    Create("iovec.tmp");
+    fd = Open("iovec.tmp");
+    if (fd < 0)
+	Exit(1);
+    iov[0].base = a; iov[0].len = 5;
+    iov[1].base = b; iov[1].len = 0;
+    iov[2].base = b; iov[2].len = 200;
+    if (WriteV(iov, 3, fd) != 205)
+	Exit(2);
+    iov[0].base = c; iov[0].len = 10;
+    iov[1].base = (char *) 0x7ffffff0; iov[1].len = 10;
+    if (WriteV(iov, 2, fd) != 10)	/* stops at the bad buffer */
+	Exit(3);
+    iov[0].len = -1;
+    if (WriteV(iov, 1, fd) != -1)
+	Exit(4);
+    if (WriteV(iov, 0, fd) != -1 || WriteV(iov, MaxIoVecs + 1, fd) != -1)
+	Exit(5);
+    Close(fd);
+
+    fd = Open("iovec.tmp");
+    if (fd < 0)
+	Exit(6);
+    iov[0].base = x; iov[0].len = 100;
+    iov[1].base = y; iov[1].len = 150;
+    n = ReadV(iov, 2, fd);
+    if (n != 215)			/* 5 + 200 + 10 */
+	Exit(7);
+    for (i = 0; i < 5; i++)
+	if (x[i] != a[i])
+	    Exit(8);
+    for (i = 0; i < 200; i++)
+	if ((i < 95 ? x[5 + i] : y[i - 95]) != b[i])
+	    Exit(9);
+    for (i = 0; i < 10; i++)
+	if (y[105 + i] != c[i])
+	    Exit(10);
+    if (ReadV(iov, 2, fd) != 0)		/* at the end of the file */
+	Exit(11);
+    Close(fd);
+    Exit(0);
+}
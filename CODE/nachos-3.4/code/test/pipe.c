@@ -0,0 +1,56 @@
+/* pipe.c
+ *	Test program for the Pipe, Exec and Join system calls.
+ *
+ *	Pass data through a pipe, checking that a read takes what is
+ *	buffered rather than waiting to fill its buffer, and sees end of
+ *	file once the writer closes.  Then run fileio as a child and Join
+ *	it, checking that its exit status comes back exactly once.
+ *	Exits with 0 if all is well, or with the number of the check that
+ *	failed.
+ */
+
+#include "syscall.h"
+
+#define SIZE	200		/* fits in a pipe's buffer */
+
+OpenFileId fds[2];
+char out[SIZE], in[SIZE + 100];
+
+int
+main()
+{
+    SpaceId child;
+    int i, n;
+
+    for (i = 0; i < SIZE; i++)
+	out[i] = 'a' + i % 26;
+
+    if (Pipe(fds) != 0)
+	Exit(1);
+    Write(out, 50, fds[1]);
+    n = Read(in, SIZE, fds[0]);		/* only 50 are there */
+    if (n != 50)
+	Exit(2);
+    Write(out, SIZE, fds[1]);
+    n = Read(in + 50, SIZE + 50, fds[0]);
+    if (n != SIZE)
+	Exit(3);
+    for (i = 0; i < 50 + SIZE; i++)
+	if (in[i] != out[i < 50 ? i : i - 50])
+	    Exit(4);
+    Close(fds[1]);
+    if (Read(in, 1, fds[0]) != 0)	/* writer gone: end of file */
+	Exit(5);
+    Close(fds[0]);
+
+    child = Exec("../test/fileio.noff");
+    if (child < 0)
+	Exit(6);
+    if (Join(child) != 0)		/* fileio's own checks passed */
+	Exit(7);
+    if (Join(child) != -1)		/* already joined */
+	Exit(8);
+    if (Join(-1) != -1)
+	Exit(9);
+    Exit(0);
+}
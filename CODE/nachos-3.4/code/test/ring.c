@@ -0,0 +1,94 @@
+/* ring.c
+ *	Test program for the submission ring: RingSetup and RingEnter.
+ *
+ *	Write a file with a batch of ring writes, then read it back with
+ *	a batch of ring reads, checking each completion's tag and byte
+ *	count, and the contents.  Also check that waiting for more than
+ *	is outstanding returns rather than hanging.  Exits with 0 if all
+ *	is well, or with the number of the check that failed.
+ */
+
+#include "syscall.h"
+
+#define OPS	8		/* operations in a batch */
+#define LEN	16		/* bytes in each */
+
+char ringMem[(RingPages + 1) * 128];	/* RingPage must be page aligned */
+char out[OPS * LEN], in[OPS * LEN];
+
+RingPage *ring;
+
+/* Queue one operation, tagged with its number */
+static void
+Submit(int op, OpenFileId fd, char *buf, int n)
+{
+    RingSqe *sqe = &ring->sq[ring->sqTail % RingEntries];
+
+    sqe->opcode = op;
+    sqe->fd = fd;
+    sqe->buf = buf;
+    sqe->len = LEN;
+    sqe->userData = n;
+    ring->sqTail++;
+}
+
+/* Wait for a batch, and check the completions; return 0 if all is well */
+static int
+Reap()
+{
+    RingCqe *cqe;
+    int n;
+
+    if (RingEnter(OPS) < OPS)
+	return 1;
+    for (n = 0; n < OPS; n++) {
+	cqe = &ring->cq[ring->cqHead % RingEntries];
+	if (cqe->userData != n || cqe->result != LEN)
+	    return 1;
+	ring->cqHead++;
+    }
+    return 0;
+}
+
+int
+main()
+{
+    OpenFileId fd;
+    int i;
+
+    for (i = 0; i < OPS * LEN; i++)
+	out[i] = 'a' + i % 26;
+    ring = (RingPage *) (((int) ringMem + 127) & ~127);
+
+    if (RingEnter(1) != -1)		/* no ring yet */
+	Exit(1);
+    if (RingSetup(ring) != 0)
+	Exit(2);
+    if (RingSetup(ring) != -1)		/* only one per process */
+	Exit(3);
+    if (RingEnter(1) != 0)		/* nothing outstanding: no wait */
+	Exit(4);
+
+    Create("ring.tmp");
+    fd = Open("ring.tmp");
+    if (fd < 0)
+	Exit(5);
+    for (i = 0; i < OPS; i++)
+	Submit(RingOpWrite, fd, out + i * LEN, i);
+    if (Reap() != 0)
+	Exit(6);
+    Close(fd);
+
+    fd = Open("ring.tmp");
+    if (fd < 0)
+	Exit(7);
+    for (i = 0; i < OPS; i++)
+	Submit(RingOpRead, fd, in + i * LEN, i);
+    if (Reap() != 0)
+	Exit(8);
+    for (i = 0; i < OPS * LEN; i++)
+	if (in[i] != out[i])
+	    Exit(9);
+    Close(fd);
+    Exit(0);
+}
@@ -3,11 +3,12 @@
 int
 main()
 {
-    SpaceId newProc;
+    SpaceId newProc, nextProc;
     OpenFileId input = ConsoleInput;
     OpenFileId output = ConsoleOutput;
-    char prompt[2], ch, buffer[60];
-    int i;
+    OpenFileId fds[2];
+    char prompt[2], ch, buffer[60], *next;
+    int i, j;
 
     prompt[0] = '-';
     prompt[1] = '-';
@@ -26,7 +27,28 @@ main()
 
 	buffer[--i] = '\0';
 
-	if( i > 0 ) {
+	/* "a | b" runs a and b with a's output piped into b's input */
+	next = 0;
+	for( j = 0; j < i; j++ )
+	    if( buffer[j] == '|' ) {
+		for( next = &buffer[j + 1]; *next == ' '; next++ )
+		    ;
+		do {
+		    buffer[j--] = '\0';
+		} while( j >= 0 && buffer[j] == ' ' );
+		break;
+	    }
+
+	if( next != 0 ) {
+		if( Pipe(fds) < 0 )
+		    continue;
+		newProc = ExecIO(buffer, input, fds[1]);
+		nextProc = ExecIO(next, fds[0], output);
+		Close(fds[0]);		/* so b sees end of file when a exits */
+		Close(fds[1]);
+		Join(newProc);
+		Join(nextProc);
+	} else if( i > 0 ) {
 		newProc = Exec(buffer);
 		Join(newProc);
 	}
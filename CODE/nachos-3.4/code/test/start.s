@@ -130,6 +130,62 @@ Yield:
 	j	$31
 	.end Yield
 
+	.globl ReadV
+	.ent	ReadV
+ReadV:
+	addiu $2,$0,SC_ReadV
+	syscall
+	j	$31
+	.end ReadV
+
+	.globl WriteV
+	.ent	WriteV
+WriteV:
+	addiu $2,$0,SC_WriteV
+	syscall
+	j	$31
+	.end WriteV
+
+	.globl RingSetup
+	.ent	RingSetup
+RingSetup:
+	addiu $2,$0,SC_RingSetup
+	syscall
+	j	$31
+	.end RingSetup
+
+	.globl RingEnter
+	.ent	RingEnter
+RingEnter:
+	addiu $2,$0,SC_RingEnter
+	syscall
+	j	$31
+	.end RingEnter
+
+	.globl Pipe
+	.ent	Pipe
+Pipe:
+	addiu $2,$0,SC_Pipe
+	syscall
+	j	$31
+	.end Pipe
+
+	.globl ExecIO
+	.ent	ExecIO
+ExecIO:
+	addiu $2,$0,SC_ExecIO
+	syscall
+	j	$31
+	.end ExecIO
+
+	.globl GetClockPage
+	.ent	GetClockPage
+GetClockPage:
+	addiu $2,$0,SC_GetClockPage
+	syscall
+	j	$31
+	.end GetClockPage
+
 /* dummy function to keep gcc happy */
         .globl  __main
         .ent    __main
@@ -9,9 +9,11 @@
 // 	Most of this file is not needed until later assignments.
 //
 // Usage: nachos -d <debugflags> -rs <random seed #>
-//		-s -x <nachos file> -c <consoleIn> <consoleOut>
-//		-f -cp <unix file> <nachos file>
-//		-p <nachos file> -r <nachos file> -l -D -t
+//		-s -st <trace file> -x <nachos file> -c <consoleIn> <consoleOut>
+//		-f -dg <tracks> <sectors per track> -bc <cache sectors>
+//		-raid <disks> <chunk sectors> -lfs
+//		-cp <unix file> <nachos file>
+//		-p <nachos file> -r <nachos file> -l -D -t -crash -recover
 //              -n <network reliability> -e <network orderability>
 //              -m <machine id>
 //              -o <other machine id>
@@ -23,17 +25,30 @@
 //
 //  USER_PROGRAM
 //    -s causes user programs to be executed in single-step mode
+//    -st writes the system call trace (cf. systrace.h) to a file at halt
 //    -x runs a user program
 //    -c tests the console
 //
 //  FILESYS
 //    -f causes the physical disk to be formatted
+//    -dg with -f, sets the geometry of the disk: tracks, sectors per track
+//    -bc sets the number of sectors in the buffer cache
+//    -ds sets the disk scheduling policy: fifo, sstf, scan or cscan
+//    -ssd simulates a flash device with the given number of channels,
+//	instead of a rotating disk
+//    -raid stripes the file system over several disks (DISK, DISK1, ...),
+//	the given number of sectors at a time
+//    -lfs keeps the file system in a log of track-sized segments, so
+//	every write is sequential; give it each time the disk is used
 //    -cp copies a file from UNIX to Nachos
 //    -p prints a Nachos file to stdout
-//    -r removes a Nachos file from the file system
+//    -r removes a Nachos file (or empty directory) from the file system
+//    -md makes a Nachos directory
 //    -l lists the contents of the Nachos directory
 //    -D prints the contents of the entire file system 
 //    -t tests the performance of the Nachos file system
+//    -crash writes some files and stops Nachos without syncing them;
+//	-recover then checks that the file system came back consistent
 //
 //  NETWORK
 //    -n sets the network reliability
@@ -60,6 +75,7 @@
 
 extern void ThreadTest(void), Copy(char *unixFile, char *nachosFile);
 extern void Print(char *file), PerformanceTest(void);
+extern void CrashTest(void), RecoveryTest(void);
 extern void StartProcess(char *file), ConsoleTest(char *in, char *out);
 extern void MailTest(int networkID);
 extern void SynchTest(void);
@@ -111,6 +127,9 @@ main(int argc, char **argv)
 	        ConsoleTest(*(argv + 1), *(argv + 2));
 	        argCount = 3;
 	    }
+#ifdef FILESYS
+	    fileSystem->Sync();		// Halt can't wait for the disk
+#endif
 	    interrupt->Halt();		// once we start the console, then 
 					// Nachos will loop forever waiting 
 					// for console input
@@ -129,12 +148,20 @@ main(int argc, char **argv)
 	    ASSERT(argc > 1);
 	    fileSystem->Remove(*(argv + 1));
 	    argCount = 2;
+	} else if (!strcmp(*argv, "-md")) {	// make Nachos directory
+	    ASSERT(argc > 1);
+	    fileSystem->MakeDirectory(*(argv + 1));
+	    argCount = 2;
 	} else if (!strcmp(*argv, "-l")) {	// list Nachos directory
             fileSystem->List();
 	} else if (!strcmp(*argv, "-D")) {	// print entire filesystem
             fileSystem->Print();
 	} else if (!strcmp(*argv, "-t")) {	// performance test
             PerformanceTest();
+	} else if (!strcmp(*argv, "-crash")) {	// stop partway through
+            CrashTest();
+	} else if (!strcmp(*argv, "-recover")) { // check what came back
+            RecoveryTest();
 	}
 #endif // FILESYS
 #ifdef NETWORK
@@ -149,6 +176,10 @@ main(int argc, char **argv)
 #endif // NETWORK
     }
 
+#ifdef FILESYS
+    fileSystem->Sync();			// while main can still wait for the
+					// disk: Cleanup can't
+#endif
     currentThread->Finish();	// NOTE: if the procedure "main" 
 				// returns, then the program "nachos"
 				// will exit (as any other normal program
@@ -8,6 +8,10 @@
 #include "copyright.h"
 #include "system.h"
 
+#ifdef FILESYS
+#include "logvolume.h"
+#endif
+
 // This defines *all* of the global data structures used by Nachos.
 // These are all initialized and de-allocated by this file.
 
@@ -24,11 +28,13 @@ FileSystem  *fileSystem;
 #endif
 
 #ifdef FILESYS
-SynchDisk   *synchDisk;
+Volume      *volume;
+BufferCache *bufferCache;
 #endif
 
 #ifdef USER_PROGRAM	// requires either FILESYS or FILESYS_STUB
 Machine *machine;	// user program memory and registers
+SyscallTrace *syscallTrace;	// system call accounting
 #endif
 
 #ifdef NETWORK
@@ -83,10 +89,21 @@ Initialize(int argc, char **argv)
 
 #ifdef USER_PROGRAM
     bool debugUserProg = FALSE;	// single step user program
+    char *traceName = NULL;	// where to dump the system call trace
 #endif
 #ifdef FILESYS_NEEDED
     bool format = FALSE;	// format disk
 #endif
+#ifdef FILESYS
+    int cacheSize = DefaultCacheSize;	// sectors in the buffer cache
+    DiskPolicy diskPolicy = DiskCSCAN;	// disk scheduling
+    int numTracks = 0, sectorsPerTrack = 0;	// geometry, when formatting
+    int flashChannels = 0;		// simulate flash, with this many
+					// channels
+    int numDisks = 1;			// disks to stripe over
+    int chunkSize = DefaultChunkSize;
+    bool logStructured = FALSE;		// keep the file system in a log
+#endif
 #ifdef NETWORK
     double rely = 1;		// network reliability
     double order = 1;           // network orderability
@@ -112,11 +129,54 @@ Initialize(int argc, char **argv)
 #ifdef USER_PROGRAM
 	if (!strcmp(*argv, "-s"))
 	    debugUserProg = TRUE;
+	else if (!strcmp(*argv, "-st")) {
+	    ASSERT(argc > 1);
+	    traceName = *(argv + 1);
+	    argCount = 2;
+	}
 #endif
 #ifdef FILESYS_NEEDED
 	if (!strcmp(*argv, "-f"))
 	    format = TRUE;
 #endif
+#ifdef FILESYS
+	if (!strcmp(*argv, "-bc")) {
+	    ASSERT(argc > 1);
+	    cacheSize = atoi(*(argv + 1));
+	    argCount = 2;
+	} else if (!strcmp(*argv, "-ds")) {
+	    ASSERT(argc > 1);
+	    if (!strcmp(*(argv + 1), "fifo"))
+		diskPolicy = DiskFIFO;
+	    else if (!strcmp(*(argv + 1), "sstf"))
+		diskPolicy = DiskSSTF;
+	    else if (!strcmp(*(argv + 1), "scan"))
+		diskPolicy = DiskSCAN;
+	    else {
+		ASSERT(!strcmp(*(argv + 1), "cscan"));
+		diskPolicy = DiskCSCAN;
+	    }
+	    argCount = 2;
+	} else if (!strcmp(*argv, "-dg")) {
+	    ASSERT(argc > 2);
+	    numTracks = atoi(*(argv + 1));
+	    sectorsPerTrack = atoi(*(argv + 2));
+	    ASSERT(numTracks > 0 && sectorsPerTrack > 0);
+	    argCount = 3;
+	} else if (!strcmp(*argv, "-ssd")) {
+	    ASSERT(argc > 1);
+	    flashChannels = atoi(*(argv + 1));
+	    ASSERT(flashChannels > 0);
+	    argCount = 2;
+	} else if (!strcmp(*argv, "-raid")) {
+	    ASSERT(argc > 2);
+	    numDisks = atoi(*(argv + 1));
+	    chunkSize = atoi(*(argv + 2));
+	    ASSERT(numDisks > 0 && chunkSize > 0);
+	    argCount = 3;
+	} else if (!strcmp(*argv, "-lfs"))
+	    logStructured = TRUE;
+#endif
 #ifdef NETWORK
 	if (!strcmp(*argv, "-n")) {
 	    ASSERT(argc > 1);
@@ -154,10 +214,19 @@ Initialize(int argc, char **argv)
     
 #ifdef USER_PROGRAM
     machine = new Machine(debugUserProg);	// this must come first
+    syscallTrace = new SyscallTrace(traceName);
 #endif
 
 #ifdef FILESYS
-    synchDisk = new SynchDisk("DISK");
+    if (!format)				// only a format may change
+	numTracks = sectorsPerTrack = 0;	// the geometry
+    if (logStructured)
+	volume = new LogVolume("DISK", numDisks, chunkSize, format, diskPolicy,
+			       numTracks, sectorsPerTrack, flashChannels);
+    else
+	volume = new Volume("DISK", numDisks, chunkSize, diskPolicy,
+			    numTracks, sectorsPerTrack, flashChannels);
+    bufferCache = new BufferCache(volume, cacheSize);
 #endif
 
 #ifdef FILESYS_NEEDED
@@ -172,6 +241,10 @@ Initialize(int argc, char **argv)
 //----------------------------------------------------------------------
 // Cleanup
 // 	Nachos is halting.  De-allocate global data structures.
+//
+//	No thread is left to wait for the disk by now, so the file system
+//	must have been synced before the halt (as main does); the file
+//	system objects only check that there is nothing left to write.
 //----------------------------------------------------------------------
 void
 Cleanup()
@@ -182,6 +255,7 @@ Cleanup()
 #endif
     
 #ifdef USER_PROGRAM
+    delete syscallTrace;
     delete machine;
 #endif
 
@@ -190,7 +264,8 @@ Cleanup()
 #endif
 
 #ifdef FILESYS
-    delete synchDisk;
+    delete bufferCache;
+    delete volume;
 #endif
     
     delete timer;
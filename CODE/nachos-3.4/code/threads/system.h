@@ -31,7 +31,9 @@ extern Timer *timer;				// the hardware alarm clock
 
 #ifdef USER_PROGRAM
 #include "machine.h"
+#include "systrace.h"
 extern Machine* machine;	// user program memory and registers
+extern SyscallTrace *syscallTrace;	// system call accounting
 #endif
 
 #ifdef FILESYS_NEEDED 		// FILESYS or FILESYS_STUB 
@@ -40,8 +42,10 @@ extern FileSystem  *fileSystem;
 #endif
 
 #ifdef FILESYS
-#include "synchdisk.h"
-extern SynchDisk   *synchDisk;
+#include "volume.h"
+#include "bufcache.h"
+extern Volume      *volume;			// the disks, striped together
+extern BufferCache *bufferCache;		// cache in front of volume
 #endif
 
 #ifdef NETWORK
@@ -40,6 +40,7 @@ Thread::Thread(char* threadName)
     status = JUST_CREATED;
 #ifdef USER_PROGRAM
     space = NULL;
+    syscallType = -1;
 #endif
 }
 
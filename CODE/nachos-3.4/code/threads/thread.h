@@ -128,6 +128,12 @@ class Thread {
     void RestoreUserState();		// restore user-level register state
 
     AddrSpace *space;			// User code this thread is running.
+
+    int syscallType;			// system call in progress, for
+					// SyscallTrace; -1 if none
+    int syscallSpace;			// ... the SpaceId that made it,
+    int syscallTicks;			// ... the time it was made,
+    double syscallHostTime;		// ... and the host time then
 #endif
 };
 
@@ -2,6 +2,11 @@
 //	Routines to manage a bitmap -- an array of bits each of which
 //	can be either on or off.  Represented as an array of integers.
 //
+//	Searches for clear bits look at a whole word at a time, and are
+//	"next fit": each starts where the last one left off, wrapping
+//	around at the end, rather than always at bit 0 -- so allocations
+//	don't all pile up at the front of the map and rescan it each time.
+//
 // Copyright (c) 1992-1993 The Regents of the University of California.
 // All rights reserved.  See copyright.h for copyright notice and limitation 
 // of liability and disclaimer of warranty provisions.
@@ -22,8 +27,9 @@ BitMap::BitMap(int nitems)
     numBits = nitems;
     numWords = divRoundUp(numBits, BitsInWord);
     map = new unsigned int[numWords];
-    for (int i = 0; i < numBits; i++) 
-        Clear(i);
+    for (int i = 0; i < numWords; i++) 
+        map[i] = 0;
+    nextFit = 0;
 }
 
 //----------------------------------------------------------------------
@@ -82,26 +88,168 @@ BitMap::Test(int which)
 	return FALSE;
 }
 
+//----------------------------------------------------------------------
+// CountTrailingZeros, CountOnes
+// 	Bit twiddling on a word: the index of the lowest 1 bit of "x"
+//	(which must not be 0), and the number of 1 bits in "x".
+//----------------------------------------------------------------------
+
+static int
+CountTrailingZeros(unsigned int x)
+{
+#if defined(__GNUC__) && (__GNUC__ >= 4)
+    return __builtin_ctz(x);
+#else
+    static const int position[32] = {	// de Bruijn sequence lookup
+	0, 1, 28, 2, 29, 14, 24, 3, 30, 22, 20, 15, 25, 17, 4, 8,
+	31, 27, 13, 23, 21, 19, 16, 7, 26, 12, 18, 6, 11, 5, 10, 9
+    };
+    return position[((x & -x) * 0x077CB531U) >> 27];
+#endif
+}
+
+static int
+CountOnes(unsigned int x)
+{
+    int count;
+
+    for (count = 0; x != 0; count++)
+	x &= x - 1;			// clear the lowest 1 bit
+    return count;
+}
+
+//----------------------------------------------------------------------
+// BitMap::FreeBits
+// 	Return word "word" of the map with its bits flipped, so clear
+//	bits show up as 1's -- leaving out the bits past the end of the
+//	map, in the last word.
+//----------------------------------------------------------------------
+
+unsigned int
+BitMap::FreeBits(int word)
+{
+    unsigned int free = ~map[word];
+    int extra = (word + 1) * BitsInWord - numBits;
+
+    if (extra > 0)
+	free &= ~0U >> extra;
+    return free;
+}
+
 //----------------------------------------------------------------------
 // BitMap::Find
-// 	Return the number of the first bit which is clear.
-//	As a side effect, set the bit (mark it as in use).
-//	(In other words, find and allocate a bit.)
+// 	Return the number of a bit which is clear, looking from where the
+//	last search left off.  As a side effect, set the bit (mark it as
+//	in use).  (In other words, find and allocate a bit.)
 //
 //	If no bits are clear, return -1.
+//
+//	"goal" -- if not -1, where to start looking instead; the first
+//	   clear bit at or after it is taken, so a caller can ask for a bit
+//	   next to one it already has
 //----------------------------------------------------------------------
 
 int 
-BitMap::Find() 
+BitMap::Find(int goal) 
 {
-    for (int i = 0; i < numBits; i++)
-	if (!Test(i)) {
-	    Mark(i);
-	    return i;
+    int start = (goal >= 0) ? goal % numBits : nextFit;
+    int first = start / BitsInWord;
+    int i, word, which;
+    unsigned int free;
+
+    for (i = 0; i <= numWords; i++) {	// the first word can come up twice
+	word = (first + i) % numWords;
+	free = FreeBits(word);
+	if (i == 0)
+	    free &= ~0U << (start % BitsInWord);	// from start on
+	if (free != 0) {
+	    which = word * BitsInWord + CountTrailingZeros(free);
+	    Mark(which);
+	    nextFit = (which + 1) % numBits;
+	    return which;
 	}
+    }
     return -1;
 }
 
+//----------------------------------------------------------------------
+// BitMap::FindRun
+// 	Return the number of the first of "count" consecutive clear bits,
+//	looking from where the last search left off (a run never wraps
+//	around the end of the map).  As a side effect, set the bits.
+//
+//	If "boundary" is given, the map is taken to be divided into
+//	segments of that many bits -- disk tracks, say -- and a run that
+//	lies within one segment is preferred: the segments are tried one
+//	at a time, from the one holding the start of the search.  Only if
+//	none of them has room is a run across a boundary taken.
+//
+//	If there is no such run, return -1.
+//
+//	"goal" -- if not -1, where to start looking instead
+//	"boundary" -- the size of a segment, or 0 for none
+//----------------------------------------------------------------------
+
+int
+BitMap::FindRun(int count, int goal, int boundary)
+{
+    int start = (goal >= 0) ? goal % numBits : nextFit;
+    int which = -1;
+    int numSegments, seg, from, to;
+
+    ASSERT(count > 0);
+    if (boundary > 0 && count <= boundary) {
+	numSegments = divRoundUp(numBits, boundary);
+	// the start's own segment comes up twice: from the start on,
+	// and at the end, the part before the start
+	for (int i = 0; i <= numSegments && which == -1; i++) {
+	    seg = ((start / boundary + i) % numSegments) * boundary;
+	    from = (i == 0) ? start : seg;
+	    to = min(seg + boundary, numBits);
+	    if (i == numSegments)
+		to = min(to, start + count - 1);
+	    which = FindRunIn(from, to, count);
+	}
+    }
+    if (which == -1)
+	which = FindRunIn(start, numBits, count);
+    if (which == -1)
+	which = FindRunIn(0, min(start + count - 1, numBits), count);
+    if (which != -1) {
+	for (int i = 0; i < count; i++)
+	    Mark(which + i);
+	nextFit = (which + count) % numBits;
+    }
+    return which;
+}
+
+//----------------------------------------------------------------------
+// BitMap::FindRunIn
+// 	Return the first of "count" consecutive clear bits within bits
+//	[from, to), or -1.  Words that are all set or all clear are
+//	stepped over whole.
+//----------------------------------------------------------------------
+
+int
+BitMap::FindRunIn(int from, int to, int count)
+{
+    int i = from, run = 0;
+    unsigned int free;
+
+    while (i < to && run < count) {
+	free = FreeBits(i / BitsInWord);
+	if ((i % BitsInWord) == 0 && i + BitsInWord <= to
+		&& (free == 0 || free == ~0U)) {
+	    run = (free == 0) ? 0 : run + BitsInWord;
+	    i += BitsInWord;
+	} else {
+	    run = (free & (1U << (i % BitsInWord))) ? run + 1 : 0;
+	    i++;
+	}
+    }
+    return (run >= count) ? i - run : -1;
+}
+
 //----------------------------------------------------------------------
 // BitMap::NumClear
 // 	Return the number of clear bits in the bitmap.
@@ -113,8 +261,25 @@ BitMap::NumClear()
 {
     int count = 0;
 
-    for (int i = 0; i < numBits; i++)
-	if (!Test(i)) count++;
+    for (int i = 0; i < numWords; i++)
+	count += CountOnes(FreeBits(i));
+    return count;
+}
+
+//----------------------------------------------------------------------
+// BitMap::NumClear
+// 	Return the number of clear bits among bits [from, to) -- how much
+//	is free in one part of the map.
+//----------------------------------------------------------------------
+
+int
+BitMap::NumClear(int from, int to)
+{
+    int count = 0;
+
+    for (int i = from; i < min(to, numBits); i++)
+	if (!Test(i))
+	    count++;
     return count;
 }
 
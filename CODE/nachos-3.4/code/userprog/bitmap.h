@@ -40,10 +40,18 @@ class BitMap {
     void Mark(int which);   	// Set the "nth" bit
     void Clear(int which);  	// Clear the "nth" bit
     bool Test(int which);   	// Is the "nth" bit set?
-    int Find();            	// Return the # of a clear bit, and as a side
+    int Find(int goal = -1);	// Return the # of a clear bit, and as a side
 				// effect, set the bit. 
 				// If no bits are clear, return -1.
+				// The search starts at "goal", if given.
+    int FindRun(int count, int goal = -1, int boundary = 0);
+				// Same, for "count" consecutive clear bits:
+				// return the first, or -1 if there is no
+				// such run.  Runs that don't cross a
+				// multiple of "boundary" come first.
     int NumClear();		// Return the number of clear bits
+    int NumClear(int from, int to);	// ... among bits [from, to)
+    int NumBits() { return numBits; }	// Return the number of bits
 
     void Print();		// Print contents of bitmap
     
@@ -59,6 +67,11 @@ class BitMap {
 					//  multiple of the number of bits in
 					//  a word)
     unsigned int *map;			// bit storage
+    int nextFit;			// where the next search starts
+
+    unsigned int FreeBits(int word);	// clear bits of a word, as 1's
+    int FindRunIn(int from, int to, int count);
+					// FindRun, over bits [from, to)
 };
 
 #endif // BITMAP_H
@@ -55,6 +55,9 @@ ExceptionHandler(ExceptionType which)
 
     if ((which == SyscallException) && (type == SC_Halt)) {
 	DEBUG('a', "Shutdown, initiated by user program.\n");
+#ifdef FILESYS
+	fileSystem->Sync();		// Halt can't wait for the disk
+#endif
    	interrupt->Halt();
     } else {
 	printf("Unexpected user mode exception %d %d\n", which, type);
@@ -29,6 +29,13 @@
 #define SC_Close	8
 #define SC_Fork		9
 #define SC_Yield	10
+#define SC_ReadV	11
+#define SC_WriteV	12
+#define SC_RingSetup	13
+#define SC_RingEnter	14
+#define SC_Pipe		15
+#define SC_ExecIO	16
+#define SC_GetClockPage	17
 
 #ifndef IN_ASM
 
@@ -108,6 +115,121 @@ int Read(char *buffer, int size, OpenFileId id);
 /* Close the file, we're done reading and writing to it. */
 void Close(OpenFileId id);
 
+/* Scatter/gather I/O.  Each IoVec names one user buffer; the buffers
+ * are transferred back to back, so a batch of records costs a single
+ * system call.  The kernel gathers them a few sectors at a time, so
+ * small records share file operations.  A transfer stops early at end
+ * of file or at the first bad buffer address.
+ */
+typedef struct {
+    char *base;		/* start of the user buffer */
+    int len;		/* number of bytes in the buffer */
+} IoVec;
+
+#define MaxIoVecs	16	/* most IoVecs accepted in one call */
+
+/* Read from the open file into the "count" buffers described by "iov".
+ * Return the total number of bytes read.
+ */
+int ReadV(IoVec *iov, int count, OpenFileId id);
+
+/* Write the "count" buffers described by "iov" to the open file.
+ * Return the total number of bytes written.
+ */
+int WriteV(IoVec *iov, int count, OpenFileId id);
+
+
+
+/* Asynchronous system calls.  A program hands the kernel RingPages pages
+ * of its memory, laid out as a RingPage, with RingSetup.  It then queues
+ * requests by filling in sq[sqTail % RingEntries] and bumping sqTail, and
+ * calls RingEnter to kick the kernel's worker thread.  The worker carries
+ * out the requests in order, in the background, and posts one completion
+ * per request at cq[cqTail % RingEntries]; the program consumes them by
+ * bumping cqHead.
+ */
+
+#define RingPages	4	/* 128 byte pages in a RingPage */
+#define RingEntries	((RingPages * 128 - 16) / 28)
+				/* slots in each queue: as many as fit
+				 * after the four indices, at 20 bytes per
+				 * RingSqe and 8 per RingCqe */
+
+#define RingOpRead	0	/* Read(buf, len, fd) */
+#define RingOpWrite	1	/* Write(buf, len, fd) */
+#define RingOpExec	2	/* Exec(buf), result is the SpaceId */
+#define RingOpYield	3	/* Yield() */
+
+typedef struct {
+    int opcode;		/* one of the RingOp's above */
+    OpenFileId fd;	/* file to read or write */
+    char *buf;		/* user buffer, or program name for RingOpExec */
+    int len;		/* number of bytes to read or write */
+    int userData;	/* copied unchanged into the completion */
+} RingSqe;
+
+typedef struct {
+    int userData;	/* from the matching RingSqe */
+    int result;		/* what the synchronous call would have returned,
+			 * -1 on error */
+} RingCqe;
+
+typedef struct {
+    int sqHead;		/* next submission the kernel will take */
+    int sqTail;		/* next free submission slot, advanced by user */
+    int cqHead;		/* next completion to consume, advanced by user */
+    int cqTail;		/* next completion the kernel will post */
+    RingSqe sq[RingEntries];
+    RingCqe cq[RingEntries];
+} RingPage;
+
+/* Share the page-aligned RingPage "ring" with the kernel. Return 0 on
+ * success, -1 if it is not page aligned, not all in the program's
+ * memory, or a ring is already set up.
+ */
+int RingSetup(RingPage *ring);
+
+/* Tell the kernel new submissions are queued, and wait until at least
+ * "minComplete" completions are ready to consume -- or fewer, if fewer
+ * requests are outstanding.  Return the number of completions ready.
+ */
+int RingEnter(int minComplete);
+
+
+/* Pipes.  A pipe is a bounded kernel buffer: bytes written to its write
+ * end come out of its read end in order.  Read waits until at least one
+ * byte is available, and returns 0 once every write end is closed;
+ * Write waits for room.  Pipe ends are closed with Close, and are
+ * closed automatically when the program Exit's.
+ */
+
+/* Create a pipe.  fds[0] is set to its read end, fds[1] to its write
+ * end.  Return 0 on success, -1 if the open file table is full.
+ */
+int Pipe(OpenFileId *fds);
+
+/* Like Exec, but the new program's ConsoleInput reads from "input" and
+ * its ConsoleOutput writes to "output", when those are pipe ends
+ * (passing ConsoleInput/ConsoleOutput leaves the console in place).
+ * The caller keeps its own copy of both ends.
+ */
+SpaceId ExecIO(char *name, OpenFileId input, OpenFileId output);
+
+
+/* The clock page.  The kernel maps one read-only page into every address
+ * space and keeps it up to date, so a program can read the time with
+ * ordinary loads instead of a system call per query.
+ */
+typedef struct {
+    int totalTicks;	/* simulated time since Nachos started */
+    int userTicks;	/* of which, ticks spent running user code */
+    SpaceId spaceId;	/* the program currently running */
+} ClockPage;
+
+/* Return the address of this program's (read-only) clock page.  One call
+ * at startup is enough; after that, just read the fields.
+ */
+ClockPage *GetClockPage();
 
 
 /* User-level thread operations: Fork and Yield.  To allow multiple
@@ -0,0 +1,197 @@
+// systrace.cc 
+//	Routines to trace the system calls made by user programs.
+//
+// Copyright (c) 1992-1993 The Regents of the University of California.
+// All rights reserved.  See copyright.h for copyright notice and limitation 
+// of liability and disclaimer of warranty provisions.
+
+#include "copyright.h"
+#include "system.h"
+#include "systrace.h"
+
+// Names of the system calls, indexed by code (see syscall.h)
+static char *syscallNames[] = {
+    "Halt", "Exit", "Exec", "Join", "Create", "Open", "Read", "Write",
+    "Close", "Fork", "Yield", "ReadV", "WriteV", "RingSetup", "RingEnter",
+    "Pipe", "ExecIO", "GetClockPage"
+};
+#define NumSyscallNames	(int) (sizeof(syscallNames) / sizeof(char *))
+
+//----------------------------------------------------------------------
+// SyscallTrace::SyscallTrace
+// 	Initialize the tables to zero.
+//
+//	"fileName" -- file to write the results to at halt, or NULL
+//----------------------------------------------------------------------
+
+SyscallTrace::SyscallTrace(char *fileName)
+{
+    dumpName = fileName;
+    bzero(byType, sizeof(byType));
+    bzero(bySpace, sizeof(bySpace));
+}
+
+SyscallTrace::~SyscallTrace()
+{
+}
+
+//----------------------------------------------------------------------
+// SyscallTrace::Begin
+// 	Note that the current thread is making system call "type".  Its
+//	latency is measured from now until the matching End.
+//
+//	"spaceId" -- the SpaceId of the calling program
+//----------------------------------------------------------------------
+
+void
+SyscallTrace::Begin(int type, int spaceId)
+{
+    if (type < 0 || type >= MaxTracedSyscalls)
+	type = MaxTracedSyscalls - 1;		// lump bad codes together
+    if (spaceId < 0 || spaceId >= MaxTracedSpaces)
+	spaceId = MaxTracedSpaces - 1;
+
+    byType[type].calls++;
+    bySpace[spaceId].calls++;
+    currentThread->syscallType = type;
+    currentThread->syscallSpace = spaceId;
+    currentThread->syscallTicks = stats->totalTicks;
+    currentThread->syscallHostTime = HostTime();
+}
+
+//----------------------------------------------------------------------
+// SyscallTrace::End
+// 	The current thread's system call is returning to the user program:
+//	charge the time since Begin to the call's type and SpaceId.
+//	A call that never returns (Exit, Halt) is counted, but not timed.
+//----------------------------------------------------------------------
+
+void
+SyscallTrace::End()
+{
+    int type = currentThread->syscallType;
+    int ticks;
+    double hostTime;
+
+    if (type == -1)
+	return;					// not traced
+    ticks = stats->totalTicks - currentThread->syscallTicks;
+    hostTime = HostTime() - currentThread->syscallHostTime;
+    Record(&byType[type], ticks, hostTime);
+    Record(&bySpace[currentThread->syscallSpace], ticks, hostTime);
+    currentThread->syscallType = -1;
+}
+
+//----------------------------------------------------------------------
+// SyscallTrace::Record
+// 	Add one completed call, that took "ticks" simulated ticks and
+//	"hostTime" host seconds, to "counts".
+//----------------------------------------------------------------------
+
+void
+SyscallTrace::Record(SyscallCounts *counts, int ticks, double hostTime)
+{
+    int bucket = 0;
+
+    while (bucket < NumLatencyBuckets - 1 && (1 << bucket) <= ticks)
+	bucket++;
+    counts->completed++;
+    counts->ticks += ticks;
+    counts->maxTicks = max(counts->maxTicks, ticks);
+    counts->hostTime += hostTime;
+    counts->histogram[bucket]++;
+}
+
+//----------------------------------------------------------------------
+// SyscallTrace::Print
+// 	Print a table of the system calls made, by type and by SpaceId,
+//	followed by a latency histogram for each type.  Then write the
+//	dump file, if there is one.
+//----------------------------------------------------------------------
+
+void
+SyscallTrace::Print()
+{
+    int i, b;
+    SyscallCounts *c;
+
+    printf("System calls:\n");
+    printf("%-12s %8s %10s %8s %8s %10s\n", "call", "count", "ticks",
+	"avg", "max", "host us");
+    for (i = 0; i < MaxTracedSyscalls; i++) {
+	c = &byType[i];
+	if (c->calls == 0)
+	    continue;
+	printf("%-12s %8d %10d %8d %8d %10.0f\n",
+	    (i < NumSyscallNames) ? syscallNames[i] : "?", c->calls,
+	    c->ticks, c->completed ? c->ticks / c->completed : 0,
+	    c->maxTicks, c->hostTime * 1000000);
+    }
+    printf("%-12s %8s %10s %8s %8s %10s\n", "space", "count", "ticks",
+	"avg", "max", "host us");
+    for (i = 0; i < MaxTracedSpaces; i++) {
+	c = &bySpace[i];
+	if (c->calls == 0)
+	    continue;
+	printf("%-12d %8d %10d %8d %8d %10.0f\n", i, c->calls,
+	    c->ticks, c->completed ? c->ticks / c->completed : 0,
+	    c->maxTicks, c->hostTime * 1000000);
+    }
+
+    printf("System call latency (ticks < 1, 2, 4, ...):\n");
+    for (i = 0; i < MaxTracedSyscalls; i++) {
+	c = &byType[i];
+	if (c->completed == 0)
+	    continue;
+	printf("%-12s", (i < NumSyscallNames) ? syscallNames[i] : "?");
+	for (b = 0; b < NumLatencyBuckets; b++)
+	    printf(" %d", c->histogram[b]);
+	printf("\n");
+    }
+
+    if (dumpName != NULL)
+	Dump();
+}
+
+//----------------------------------------------------------------------
+// SyscallTrace::Dump
+// 	Write the results to "dumpName", one whitespace separated record
+//	per line:
+//
+//	syscall <code> <name> <calls> <completed> <ticks> <maxTicks>
+//		<hostMicroseconds> <histogram buckets...>
+//	space <spaceId> <calls> <completed> <ticks> <maxTicks>
+//		<hostMicroseconds>
+//----------------------------------------------------------------------
+
+void
+SyscallTrace::Dump()
+{
+    FILE *fp = fopen(dumpName, "w");
+    int i, b;
+    SyscallCounts *c;
+
+    if (fp == NULL) {
+	printf("Unable to write system call trace to %s\n", dumpName);
+	return;
+    }
+    for (i = 0; i < MaxTracedSyscalls; i++) {
+	c = &byType[i];
+	if (c->calls == 0)
+	    continue;
+	fprintf(fp, "syscall %d %s %d %d %d %d %.0f", i,
+	    (i < NumSyscallNames) ? syscallNames[i] : "?", c->calls,
+	    c->completed, c->ticks, c->maxTicks, c->hostTime * 1000000);
+	for (b = 0; b < NumLatencyBuckets; b++)
+	    fprintf(fp, " %d", c->histogram[b]);
+	fprintf(fp, "\n");
+    }
+    for (i = 0; i < MaxTracedSpaces; i++) {
+	c = &bySpace[i];
+	if (c->calls == 0)
+	    continue;
+	fprintf(fp, "space %d %d %d %d %d %.0f\n", i, c->calls,
+	    c->completed, c->ticks, c->maxTicks, c->hostTime * 1000000);
+    }
+    fclose(fp);
+}
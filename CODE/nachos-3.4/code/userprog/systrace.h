@@ -0,0 +1,65 @@
+// systrace.h 
+//	Data structures for tracing system calls.
+//
+//	ExceptionHandler calls Begin when a user program traps in with a
+//	system call, and AdvancePC calls End when the call returns to the
+//	program.  For each kind of system call we count the calls, keep a
+//	histogram of how long they took in simulated ticks, and add up the
+//	host time spent in them; calls are also tallied per SpaceId.
+//
+//	The results are printed as a table when Nachos halts, and, with
+//	the "-st <file>" flag, written to <file> one record per line for
+//	scripts to digest.
+//
+// Copyright (c) 1992-1993 The Regents of the University of California.
+// All rights reserved.  See copyright.h for copyright notice and limitation 
+// of liability and disclaimer of warranty provisions.
+
+#ifndef SYSTRACE_H
+#define SYSTRACE_H
+
+#include "copyright.h"
+
+#define MaxTracedSyscalls	32	// system call codes 0 .. 31
+#define MaxTracedSpaces		128	// SpaceId's 0 .. 127
+#define NumLatencyBuckets	16	// bucket i counts latencies in
+					// [2^(i-1), 2^i) ticks; bucket 0
+					// is 0 ticks, the last is open ended
+
+// What we know about one kind of system call, or one SpaceId.
+
+class SyscallCounts {
+  public:
+    int calls;				// number of calls made
+    int completed;			// ... of which returned to the user
+    int ticks;				// simulated ticks in completed calls
+    int maxTicks;			// longest completed call
+    double hostTime;			// host seconds in completed calls
+    int histogram[NumLatencyBuckets];	// completed calls, by latency
+};
+
+// The following class records the system calls made by user programs.
+
+class SyscallTrace {
+  public:
+    SyscallTrace(char *fileName);	// Start tracing; if "fileName" is
+					// non-NULL, dump the results there
+    ~SyscallTrace();
+
+    void Begin(int type, int spaceId);	// currentThread made system call
+					// "type" from address space "spaceId"
+    void End();				// currentThread's system call is done
+
+    void Print();			// Print the tables, and write the
+					// dump file if one was asked for
+
+  private:
+    void Record(SyscallCounts *counts, int ticks, double hostTime);
+    void Dump();
+
+    char *dumpName;			// where to dump the results, or NULL
+    SyscallCounts byType[MaxTracedSyscalls];
+    SyscallCounts bySpace[MaxTracedSpaces];
+};
+
+#endif // SYSTRACE_H